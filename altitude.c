@@ -17,8 +17,13 @@
 #include "driverlib/adc.h"
 #include "driverlib/sysctl.h"
 #include "circBufT.h"
-#include "rotors.h"
-#include "flightState.h"
+#include "trajectory.h"
+#include "estimator.h"
+#include "vehicleState.h"
+#include "inputCapture.h"
+#include "benchmark.h"
+#include "wcet.h"
+#include "board.h"
 
 #include "altitude.h"
 
@@ -31,22 +36,34 @@
 #define MIN_ALTITUDE            0
 #define MAX_ALTITUDE            100
 
+// Altitude held while finding the yaw reference. Units: %
+#define TAKEOFF_ALTITUDE        10
+
+// Below this altitude the final approach of a landing starts, during which
+// the reference descends at a reduced rate. Units: %, % per second
+#define FINAL_APPROACH_ALTITUDE 10
+#define FINAL_APPROACH_RATE     5
+
+// Default band around zero which the altitude must stay within, and for
+// how long, for a landing to be complete. Units: %, ms
+#define LANDING_TOLERANCE       2
+#define LANDING_DWELL_MS        250
+
+// Limits on the rate and acceleration of the reference altitude.
+#define MAX_ALTITUDE_RATE       20    // Units: % per second
+#define MAX_ALTITUDE_ACCEL      40    // Units: % per second squared
+
 // The range over which the ADC sample values vary, from landed to fully up.
 // Calculated as: 4095 * (0.8V / 3.3V)
 #define ADC_RANGE               993
 
-// Constants related to the ADC peripheral.
-#define ALTITUDE_ADC_PERIPH             SYSCTL_PERIPH_ADC0
-#define ALTITUDE_ADC_BASE               ADC0_BASE
-#define ALTITUDE_ADC_SEQUENCE           3
-#define ALTITUDE_ADC_SEQUENCE_PRIORITY  0
-#define ALTITUDE_ADC_STEP               0
-#define ALTITUDE_ADC_CHANNEL            ADC_CTL_CH9
-
 
 //*****************************************************************************
 // Static variables
 //*****************************************************************************
+// The ADC sequence step used to sample the altitude sensor.
+static const boardAdc_t altitudeAdc = BOARD_ALTITUDE_ADC;
+
 static circBuf_t inBuffer;    // Circular buffer containing ADC samples.
 static int16_t meanADC;       // Current mean ADC value.
 static int32_t sumADC;        // Current sum of the ADC samples in the buffer.
@@ -55,8 +72,22 @@ static int16_t referenceADC;  // ADC value corresponding to 'landed' altitude.
 // Number of ADC samples taken, used to check whether buffer is filled yet.
 static uint32_t numSamplesTaken = 0;
 
-// The desired altitude as a percentage.
-static int16_t desiredAltitude = 0;
+// Whether the reference ADC value has been set, and the samples can
+// therefore be passed to the estimator.
+static volatile bool referenceSet = false;
+
+// Trajectory of the reference altitude as a percentage, which moves smoothly
+// towards the desired altitude (the trajectory's target).
+static trajectory_t altitudeTrajectory;
+
+// Rate at which the reference is updated, in Hz.
+static uint16_t referenceUpdateRate = 1;
+
+// Landing completion band and dwell time, and the number of consecutive
+// updates for which the altitude has been within the band.
+static uint16_t landingTolerance = LANDING_TOLERANCE;
+static uint16_t landingDwellMs = LANDING_DWELL_MS;
+static uint32_t landingDwellUpdates = 0;
 
 
 //*****************************************************************************
@@ -71,6 +102,8 @@ static void altitudeADCIntHandler(void);
 //*****************************************************************************
 void initAltitude(void) {
     initCircBuf(&inBuffer, BUF_SIZE);
+    initTrajectory(&altitudeTrajectory, MAX_ALTITUDE_RATE, MAX_ALTITUDE_ACCEL,
+                   0);
     initAltitudeADC();
 }
 
@@ -79,32 +112,32 @@ void initAltitude(void) {
 //*****************************************************************************
 static void initAltitudeADC(void) {
     // The ADC peripheral must be enabled for configuration and use.
-    SysCtlPeripheralEnable(ALTITUDE_ADC_PERIPH);
+    SysCtlPeripheralEnable(altitudeAdc.periph);
 
     // Enable the sample sequence with a processor signal trigger.
-    ADCSequenceConfigure(ALTITUDE_ADC_BASE,
-                         ALTITUDE_ADC_SEQUENCE,
+    ADCSequenceConfigure(altitudeAdc.base,
+                         altitudeAdc.sequence,
                          ADC_TRIGGER_PROCESSOR,
-                         ALTITUDE_ADC_SEQUENCE_PRIORITY);
+                         altitudeAdc.priority);
 
     // Configure the ADC step. The ADC channel is sampled in single-ended mode
     // (default), the interrupt flag is to be set when the sample is done,
     // and this is the last conversion done on the sequence.
-    ADCSequenceStepConfigure(ALTITUDE_ADC_BASE,
-                             ALTITUDE_ADC_SEQUENCE,
-                             ALTITUDE_ADC_STEP,
-                             ALTITUDE_ADC_CHANNEL | ADC_CTL_IE | ADC_CTL_END);
+    ADCSequenceStepConfigure(altitudeAdc.base,
+                             altitudeAdc.sequence,
+                             altitudeAdc.step,
+                             altitudeAdc.channel | ADC_CTL_IE | ADC_CTL_END);
 
     // Enable the sequence.
-    ADCSequenceEnable(ALTITUDE_ADC_BASE, ALTITUDE_ADC_SEQUENCE);
+    ADCSequenceEnable(altitudeAdc.base, altitudeAdc.sequence);
 
     // Register the conversion complete interrupt handler.
-    ADCIntRegister(ALTITUDE_ADC_BASE,
-                   ALTITUDE_ADC_SEQUENCE,
+    ADCIntRegister(altitudeAdc.base,
+                   altitudeAdc.sequence,
                    altitudeADCIntHandler);
 
     // Enable interrupts for the ADC sequence
-    ADCIntEnable(ALTITUDE_ADC_BASE, ALTITUDE_ADC_SEQUENCE);
+    ADCIntEnable(altitudeAdc.base, altitudeAdc.sequence);
 }
 
 //*****************************************************************************
@@ -117,6 +150,7 @@ void altitudeSetReference(void) {
     // Wait for the buffer to be filled before setting the reference value.
     while (numSamplesTaken < BUF_SIZE) {}
     referenceADC = meanADC;
+    referenceSet = true;
 }
 
 //*****************************************************************************
@@ -124,19 +158,39 @@ void altitudeSetReference(void) {
 // altitude. Should be called at a rate equal to the desired sampling rate.
 //*****************************************************************************
 void altitudeTriggerConversion(void) {
-    ADCProcessorTrigger(ALTITUDE_ADC_BASE, ALTITUDE_ADC_SEQUENCE);
+    ADCProcessorTrigger(altitudeAdc.base, altitudeAdc.sequence);
 }
 
 //*****************************************************************************
 // The handler for the ADC conversion complete interrupt.
-// Reads the oldest value in the circular buffer before writing the the new
-// value, and uses these two values to recalculate the mean ADC value.
+// Reads the new sample from the ADC module and processes it.
 //*****************************************************************************
 static void altitudeADCIntHandler(void) {
-    uint32_t oldestValue, newValue;
+    WCET_ISR_ENTER(WCET_ISR_ADC);
+    uint32_t newValue;
 
     // Get the new sample from the ADC module.
-    ADCSequenceDataGet(ALTITUDE_ADC_BASE, ALTITUDE_ADC_SEQUENCE, &newValue);
+    ADCSequenceDataGet(altitudeAdc.base, altitudeAdc.sequence, &newValue);
+
+    BENCHMARK_START(BENCH_ADC_SAMPLE);
+    altitudeProcessSample(newValue);
+    BENCHMARK_STOP(BENCH_ADC_SAMPLE);
+
+    // Clean up, clearing the interrupt.
+    ADCIntClear(altitudeAdc.base, altitudeAdc.sequence);
+    WCET_ISR_EXIT(WCET_ISR_ADC);
+}
+
+//*****************************************************************************
+// Processes a new ADC sample. Reads the oldest value in the circular buffer
+// before writing the the new value, and uses these two values to recalculate
+// the mean ADC value. Called from the ADC interrupt handler, or when
+// replaying captured samples.
+//*****************************************************************************
+void altitudeProcessSample(uint32_t newValue) {
+    uint32_t oldestValue;
+
+    inputCaptureRecord(CAPTURE_ADC, newValue);
     numSamplesTaken++;
 
     // Get the oldest value from the circular buffer (before it is overwritten).
@@ -149,8 +203,14 @@ static void altitudeADCIntHandler(void) {
     sumADC = sumADC - oldestValue + newValue;
     meanADC = (2 * sumADC + BUF_SIZE) / 2 / BUF_SIZE;
 
-    // Clean up, clearing the interrupt.
-    ADCIntClear(ALTITUDE_ADC_BASE, ALTITUDE_ADC_SEQUENCE);
+    // Pass the new sample (in units of 0.01%) to the estimator.
+    if (referenceSet) {
+        estimatorUpdate(((int32_t) referenceADC - (int32_t) newValue)
+                        * 10000 / ADC_RANGE);
+    }
+
+    // Publish a snapshot of the helicopter state at the sample rate.
+    vehicleStatePublish();
 }
 
 //*****************************************************************************
@@ -161,51 +221,116 @@ int16_t altitudePercent(void) {
     return (referenceADC - meanADC) * 100 / ADC_RANGE;
 }
 
+//*****************************************************************************
+// Returns the current mean ADC value.
+//*****************************************************************************
+int16_t altitudeMeanADC(void) {
+    return meanADC;
+}
+
 //*****************************************************************************
 // Adds the given amount to the desired altitude, ensuring that it remains
 // within the limits.
 //*****************************************************************************
 void altitudeChangeDesired(int16_t amount) {
-    desiredAltitude += amount;
+    int16_t desiredAltitude = trajectoryTarget(&altitudeTrajectory) + amount;
 
     if (desiredAltitude > MAX_ALTITUDE) {
         desiredAltitude = MAX_ALTITUDE;
     } else if (desiredAltitude < MIN_ALTITUDE) {
         desiredAltitude = MIN_ALTITUDE;
     }
+
+    trajectorySetTarget(&altitudeTrajectory, desiredAltitude);
+}
+
+//*****************************************************************************
+// Advances the reference altitude towards the desired altitude. Should be
+// called at the given update rate (in Hz), before the altitude error is used.
+//*****************************************************************************
+void altitudeUpdateReference(uint16_t updateRate) {
+    referenceUpdateRate = updateRate;
+    trajectoryUpdate(&altitudeTrajectory, updateRate);
+}
+
+//*****************************************************************************
+// Sets the desired altitude to a safe hover for takeoff, which is held
+// while the yaw reference is found.
+//*****************************************************************************
+void altitudeStartTakeoff(void) {
+    trajectorySetLimits(&altitudeTrajectory, MAX_ALTITUDE_RATE,
+                        MAX_ALTITUDE_ACCEL);
+    trajectorySetTarget(&altitudeTrajectory, TAKEOFF_ALTITUDE);
+}
+
+//*****************************************************************************
+// Starts reducing the altitude to zero for landing, by setting the desired
+// altitude to zero.
+//*****************************************************************************
+void altitudeStartLanding(void) {
+    trajectorySetTarget(&altitudeTrajectory, MIN_ALTITUDE);
+    landingDwellUpdates = 0;
+}
+
+//*****************************************************************************
+// Called at each control update while landing. Once the reference altitude
+// is below the final approach altitude, reduces its rate limit so that the
+// helicopter touches down slowly.
+//*****************************************************************************
+void altitudeUpdateLanding(void) {
+    if (trajectoryPosition(&altitudeTrajectory) <= FINAL_APPROACH_ALTITUDE) {
+        trajectorySetLimits(&altitudeTrajectory, FINAL_APPROACH_RATE,
+                            MAX_ALTITUDE_ACCEL);
+    }
 }
 
 //*****************************************************************************
-// Called when the altitude is being reduced to zero for landing. Decreases
-// the desired altitude by the given amount, changing the flight state to
-// landed and stopping the rotors if the altitude has reached zero.
+// Returns whether the reference has reached zero and the altitude has been
+// within the landing tolerance of it for the landing dwell time, after
+// altitudeStartLanding was called. Should be called at each control update.
 //*****************************************************************************
-void altitudeUpdateLanding(int16_t amount) {
-    if (desiredAltitude > MIN_ALTITUDE) {
-        desiredAltitude -= amount;
-        if (desiredAltitude < MIN_ALTITUDE) {
-            desiredAltitude = MIN_ALTITUDE;
-        }
-    } else if (desiredAltitude == MIN_ALTITUDE) {
-        if (altitudeError() == 0) {
-            stopMainRotor();
-            stopTailRotor();
-            setFlightState(LANDED);
-        }
+bool altitudeLandingComplete(void) {
+    int16_t error = altitudeError();
+
+    if (!trajectoryFinished(&altitudeTrajectory)
+            || error > landingTolerance || error < -landingTolerance) {
+        landingDwellUpdates = 0;
+        return false;
     }
+
+    landingDwellUpdates++;
+    return landingDwellUpdates * 1000
+           >= (uint32_t) landingDwellMs * referenceUpdateRate;
+}
+
+//*****************************************************************************
+// Sets the band around zero which the altitude must stay within (in %),
+// and for how long (in ms), for a landing to be complete.
+//*****************************************************************************
+void altitudeSetLandingTolerance(uint16_t tolerance, uint16_t dwellMs) {
+    landingTolerance = tolerance;
+    landingDwellMs = dwellMs;
 }
 
 //*****************************************************************************
 // Returns the desired percentage altitude.
 //*****************************************************************************
 int16_t altitudeDesired(void) {
-    return desiredAltitude;
+    return trajectoryTarget(&altitudeTrajectory);
+}
+
+//*****************************************************************************
+// Returns the current reference altitude as a percentage, which moves
+// smoothly towards the desired altitude.
+//*****************************************************************************
+int16_t altitudeReference(void) {
+    return trajectoryPosition(&altitudeTrajectory);
 }
 
 //*****************************************************************************
-// Calculates and returns the difference between the desired altitude and
+// Calculates and returns the difference between the reference altitude and
 // the current altitude, as a percent.
 //*****************************************************************************
 int16_t altitudeError(void) {
-    return desiredAltitude - altitudePercent();
+    return altitudeReference() - altitudePercent();
 }
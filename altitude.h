@@ -34,12 +34,25 @@ void altitudeSetReference(void);
 //*****************************************************************************
 void altitudeTriggerConversion(void);
 
+//*****************************************************************************
+// Processes a new ADC sample. Reads the oldest value in the circular buffer
+// before writing the the new value, and uses these two values to recalculate
+// the mean ADC value. Called from the ADC interrupt handler, or when
+// replaying captured samples.
+//*****************************************************************************
+void altitudeProcessSample(uint32_t newValue);
+
 //*****************************************************************************
 // Calculates and returns the current percentage altitude, relative to the
 // referenceADC value. Percentage can be positive or negative.
 //*****************************************************************************
 int16_t altitudePercent(void);
 
+//*****************************************************************************
+// Returns the current mean ADC value.
+//*****************************************************************************
+int16_t altitudeMeanADC(void);
+
 //*****************************************************************************
 // Adds the given amount to the desired altitude, ensuring that it remains
 // within the limits.
@@ -47,11 +60,42 @@ int16_t altitudePercent(void);
 void altitudeChangeDesired(int16_t amount);
 
 //*****************************************************************************
-// Called when the altitude is being reduced to zero for landing. Decreases
-// the desired altitude by the given amount, changing the flight state to
-// landed and stopping the rotors if the altitude has reached zero.
+// Advances the reference altitude towards the desired altitude. Should be
+// called at the given update rate (in Hz), before the altitude error is used.
+//*****************************************************************************
+void altitudeUpdateReference(uint16_t updateRate);
+
+//*****************************************************************************
+// Sets the desired altitude to a safe hover for takeoff, which is held
+// while the yaw reference is found.
+//*****************************************************************************
+void altitudeStartTakeoff(void);
+
+//*****************************************************************************
+// Starts reducing the altitude to zero for landing, by setting the desired
+// altitude to zero.
 //*****************************************************************************
-void altitudeUpdateLanding(int16_t amount);
+void altitudeStartLanding(void);
+
+//*****************************************************************************
+// Called at each control update while landing. Once the reference altitude
+// is below the final approach altitude, reduces its rate limit so that the
+// helicopter touches down slowly.
+//*****************************************************************************
+void altitudeUpdateLanding(void);
+
+//*****************************************************************************
+// Returns whether the reference has reached zero and the altitude has been
+// within the landing tolerance of it for the landing dwell time, after
+// altitudeStartLanding was called. Should be called at each control update.
+//*****************************************************************************
+bool altitudeLandingComplete(void);
+
+//*****************************************************************************
+// Sets the band around zero which the altitude must stay within (in %),
+// and for how long (in ms), for a landing to be complete.
+//*****************************************************************************
+void altitudeSetLandingTolerance(uint16_t tolerance, uint16_t dwellMs);
 
 //*****************************************************************************
 // Returns the desired percentage altitude.
@@ -59,7 +103,13 @@ void altitudeUpdateLanding(int16_t amount);
 int16_t altitudeDesired(void);
 
 //*****************************************************************************
-// Calculates and returns the difference between the desired altitude and
+// Returns the current reference altitude as a percentage, which moves
+// smoothly towards the desired altitude.
+//*****************************************************************************
+int16_t altitudeReference(void);
+
+//*****************************************************************************
+// Calculates and returns the difference between the reference altitude and
 // the current altitude, as a percent.
 //*****************************************************************************
 int16_t altitudeError(void);
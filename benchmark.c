@@ -0,0 +1,145 @@
+//*****************************************************************************
+//
+// File: benchmark.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module for measuring the cost of the hot paths in cycles, using the DWT
+// cycle counter of the Cortex-M4. Results are sent over UART as one line of
+// JSON per hot path, and compared against stored cycle budgets so that a
+// slowdown is reported as a failure.
+//
+// Measurement is only compiled in when BENCHMARK_ENABLED is defined (e.g.
+// in a separate build configuration), otherwise the macros in benchmark.h
+// are empty and benchmarkReport does nothing.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/ustdlib.h"
+#include "uartUSB.h"
+
+#include "benchmark.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Maximum length of a line of JSON.
+#define LINE_LEN                100
+
+
+//*****************************************************************************
+// Results for one hot path.
+//*****************************************************************************
+typedef struct {
+    uint32_t calls;
+    uint32_t totalCycles;
+    uint32_t maxCycles;
+} benchmarkResult_t;
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+
+// Names of the hot paths, and the budget for the mean number of cycles per
+// call of each. These are the baselines: a mean above the budget is
+// reported as a failure. Update them from a reference run when a change
+// is intended to make a path slower.
+static const char* const benchmarkNames[NUM_BENCHMARKS] = {
+    "altitudeProcessSample",
+    "yawProcessChannels",
+    "updateButtons",
+    "schedulerUpdateTicks",
+    "controlUpdate",
+    "usnprintf",
+    "OLEDStringDraw",
+    "setMainRotorDuty",
+    "actuatorLatency",
+    "SysTickIntHandler"
+};
+
+static const uint32_t benchmarkBudgets[NUM_BENCHMARKS] = {
+    1500,       // altitudeProcessSample
+    400,        // yawProcessChannels
+    400,        // updateButtons
+    200,        // schedulerUpdateTicks
+    4000,       // controlUpdate
+    3000,       // usnprintf
+    40000,      // OLEDStringDraw
+    150,        // setMainRotorDuty
+    320000,     // actuatorLatency: one 250Hz PWM period at 80MHz
+    400         // SysTickIntHandler
+};
+
+static volatile benchmarkResult_t results[NUM_BENCHMARKS];
+
+// The next hot path to report, and whether all reported so far passed.
+static uint8_t reportIndex = 0;
+static bool allPassed = true;
+
+
+//*****************************************************************************
+// Enables the DWT cycle counter.
+//*****************************************************************************
+void initBenchmark(void) {
+#ifdef BENCHMARK_ENABLED
+    initCycleCounter();
+#endif
+}
+
+//*****************************************************************************
+// Records one measurement of the given hot path, in cycles.
+//*****************************************************************************
+void benchmarkRecord(benchmarkId_t id, uint32_t cycles) {
+    volatile benchmarkResult_t* result = &results[id];
+
+    result->calls++;
+    result->totalCycles += cycles;
+    if (cycles > result->maxCycles) {
+        result->maxCycles = cycles;
+    }
+}
+
+//*****************************************************************************
+// Sends the results for the next hot path over UART as a line of JSON,
+// cycling through all of them, followed by an overall result line. Should
+// be called regularly as a background task.
+//*****************************************************************************
+void benchmarkReport(void) {
+#ifdef BENCHMARK_ENABLED
+    char line[LINE_LEN + 1];
+
+    if (reportIndex >= NUM_BENCHMARKS) {
+        usnprintf(line, sizeof(line), "{\"result\":\"%s\"}\r\n",
+                  allPassed ? "PASS" : "FAIL");
+        uartSend(line);
+        reportIndex = 0;
+        allPassed = true;
+        return;
+    }
+
+    volatile benchmarkResult_t* result = &results[reportIndex];
+    uint32_t mean = 0;
+    if (result->calls > 0) {
+        mean = result->totalCycles / result->calls;
+    }
+    bool passed = mean <= benchmarkBudgets[reportIndex];
+    allPassed = allPassed && passed;
+
+    usnprintf(line, sizeof(line),
+              "{\"name\":\"%s\",\"calls\":%u,\"mean\":%u,\"max\":%u,"
+              "\"budget\":%u,\"pass\":%s}\r\n",
+              benchmarkNames[reportIndex], result->calls, mean,
+              result->maxCycles, benchmarkBudgets[reportIndex],
+              passed ? "true" : "false");
+    uartSend(line);
+
+    reportIndex++;
+#endif
+}
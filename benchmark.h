@@ -0,0 +1,76 @@
+//*****************************************************************************
+//
+// File: benchmark.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module for measuring the cost of the hot paths in cycles, using the DWT
+// cycle counter of the Cortex-M4. Results are sent over UART as one line of
+// JSON per hot path, and compared against stored cycle budgets so that a
+// slowdown is reported as a failure.
+//
+// Measurement is only compiled in when BENCHMARK_ENABLED is defined (e.g.
+// in a separate build configuration), otherwise the macros below are empty
+// and benchmarkReport does nothing.
+//
+//*****************************************************************************
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include "cycleCounter.h"
+
+
+// The hot paths which are measured.
+enum benchmarkIds {BENCH_ADC_SAMPLE = 0,     // altitudeProcessSample
+                   BENCH_YAW_EDGE,           // yawProcessChannels
+                   BENCH_BUTTONS,            // updateButtons
+                   BENCH_SCHEDULER_TICKS,    // schedulerUpdateTicks
+                   BENCH_CONTROL,            // controlUpdate
+                   BENCH_FORMAT,             // usnprintf of one display line
+                   BENCH_OLED_DRAW,          // OLEDStringDraw of one line
+                   BENCH_ROTOR_SET,          // setMainRotorDuty
+                   BENCH_ACTUATOR_LATENCY,   // rotorsUpdate to PWM latch
+                   BENCH_SYSTICK,            // SysTickIntHandler
+                   NUM_BENCHMARKS};
+
+typedef enum benchmarkIds benchmarkId_t;
+
+
+#ifdef BENCHMARK_ENABLED
+
+// Start and stop measuring the given hot path, within one block.
+#define BENCHMARK_START(id) \
+    uint32_t benchmarkStart_##id = CYCLE_COUNTER
+#define BENCHMARK_STOP(id) \
+    benchmarkRecord(id, CYCLE_COUNTER - benchmarkStart_##id)
+
+#else
+
+#define BENCHMARK_START(id)
+#define BENCHMARK_STOP(id)
+
+#endif
+
+
+//*****************************************************************************
+// Enables the DWT cycle counter.
+//*****************************************************************************
+void initBenchmark(void);
+
+//*****************************************************************************
+// Records one measurement of the given hot path, in cycles.
+//*****************************************************************************
+void benchmarkRecord(benchmarkId_t id, uint32_t cycles);
+
+//*****************************************************************************
+// Sends the results for the next hot path over UART as a line of JSON,
+// cycling through all of them, followed by an overall result line. Should
+// be called regularly as a background task.
+//*****************************************************************************
+void benchmarkReport(void);
+
+
+#endif  // BENCHMARK_H_
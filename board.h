@@ -0,0 +1,150 @@
+//*****************************************************************************
+//
+// File: board.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Description of the rig: the peripherals and pins used for each input and
+// output of the helicopter. Each is given as an initialiser for a
+// descriptor, which the module using it instantiates as a const table and
+// initialises in a loop. As the tables are const and indexed by constants,
+// the compiler resolves each access at compile time, so there is no cost
+// over using the constants directly. Porting to another rig revision, or
+// adding a button or rotor, is an edit to this file.
+//
+// The initialisers use the TivaWare constants, so this file must be
+// included after the TivaWare headers for the peripherals used.
+//
+//*****************************************************************************
+
+#ifndef BOARD_H_
+#define BOARD_H_
+
+
+//*****************************************************************************
+// Descriptors
+//*****************************************************************************
+
+// A GPIO pin, with its port.
+typedef struct {
+    uint32_t periph;        // SYSCTL_PERIPH_GPIOx
+    uint32_t base;          // GPIO_PORTx_BASE
+    uint8_t pin;            // GPIO_PIN_n
+} boardPin_t;
+
+// A button. Pins which are locked at reset (PD7 and PF0) are unlocked
+// before they are configured.
+typedef struct {
+    boardPin_t gpio;
+    uint32_t padType;       // Pull-up or pull-down
+    bool normal;            // Pin level when the button is released
+    bool locked;
+} boardButton_t;
+
+// A rotor, driven by one output of a PWM generator.
+typedef struct {
+    boardPin_t gpio;
+    uint32_t pinConfig;     // GPIO_Pxn_MnPWMn
+    uint32_t pwmPeriph;     // SYSCTL_PERIPH_PWMn
+    uint32_t pwmBase;       // PWMn_BASE
+    uint32_t gen;           // PWM_GEN_n
+    uint32_t genBit;        // PWM_GEN_n_BIT
+    uint32_t genInt;        // PWM_INT_GEN_n
+    uint32_t outNum;        // PWM_OUT_n
+    uint32_t outBit;        // PWM_OUT_n_BIT
+} boardRotor_t;
+
+// An ADC input, sampled by one step of a sample sequence.
+typedef struct {
+    uint32_t periph;        // SYSCTL_PERIPH_ADCn
+    uint32_t base;          // ADCn_BASE
+    uint32_t sequence;
+    uint32_t priority;
+    uint32_t step;
+    uint32_t channel;       // ADC_CTL_CHn
+} boardAdc_t;
+
+// A UART, with its receive and transmit pins, which must be on one port.
+typedef struct {
+    uint32_t periph;        // SYSCTL_PERIPH_UARTn
+    uint32_t base;          // UARTn_BASE
+    boardPin_t rx;
+    boardPin_t tx;
+    uint32_t rxConfig;      // GPIO_Pxn_UnRX
+    uint32_t txConfig;      // GPIO_Pxn_UnTX
+} boardUart_t;
+
+
+//*****************************************************************************
+// Rig revision
+//*****************************************************************************
+
+// The revision of the rig. May be overridden in the build configuration.
+#ifndef BOARD_REVISION
+#define BOARD_REVISION  1
+#endif
+
+#if BOARD_REVISION == 1
+
+// Buttons, in the order of the button names in buttons4.h. Buttons on the
+// same port must be adjacent, so that each port is read once. UP and DOWN
+// are on the Orbit daughterboard, and LEFT and RIGHT on the Tiva.
+#define BOARD_BUTTONS { \
+    {{SYSCTL_PERIPH_GPIOE, GPIO_PORTE_BASE, GPIO_PIN_0},    /* UP */    \
+     GPIO_PIN_TYPE_STD_WPD, false, false},                              \
+    {{SYSCTL_PERIPH_GPIOD, GPIO_PORTD_BASE, GPIO_PIN_2},    /* DOWN */  \
+     GPIO_PIN_TYPE_STD_WPD, false, false},                              \
+    {{SYSCTL_PERIPH_GPIOF, GPIO_PORTF_BASE, GPIO_PIN_4},    /* LEFT */  \
+     GPIO_PIN_TYPE_STD_WPU, true, false},                               \
+    {{SYSCTL_PERIPH_GPIOF, GPIO_PORTF_BASE, GPIO_PIN_0},    /* RIGHT */ \
+     GPIO_PIN_TYPE_STD_WPU, true, true}                                 \
+}
+
+// Switch 1 on the Orbit daughterboard. Reads high when up.
+#define BOARD_SWITCH \
+    {SYSCTL_PERIPH_GPIOA, GPIO_PORTA_BASE, GPIO_PIN_7}
+
+// Rotors, in the order of the rotor names below.
+#define BOARD_ROTORS { \
+    {{SYSCTL_PERIPH_GPIOC, GPIO_PORTC_BASE, GPIO_PIN_5},    /* Main */  \
+     GPIO_PC5_M0PWM7, SYSCTL_PERIPH_PWM0, PWM0_BASE,                    \
+     PWM_GEN_3, PWM_GEN_3_BIT, PWM_INT_GEN_3,                           \
+     PWM_OUT_7, PWM_OUT_7_BIT},                                         \
+    {{SYSCTL_PERIPH_GPIOF, GPIO_PORTF_BASE, GPIO_PIN_1},    /* Tail */  \
+     GPIO_PF1_M1PWM5, SYSCTL_PERIPH_PWM1, PWM1_BASE,                    \
+     PWM_GEN_2, PWM_GEN_2_BIT, PWM_INT_GEN_2,                           \
+     PWM_OUT_5, PWM_OUT_5_BIT}                                          \
+}
+
+// Yaw quadrature channels A and B, which must be on the same port, and the
+// active low yaw reference signal.
+#define BOARD_YAW_CHANNEL_A \
+    {SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PIN_0}
+#define BOARD_YAW_CHANNEL_B \
+    {SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PIN_1}
+#define BOARD_YAW_REFERENCE \
+    {SYSCTL_PERIPH_GPIOC, GPIO_PORTC_BASE, GPIO_PIN_4}
+
+// Altitude sensor, on AIN9 (PE4), sampled by sequence 3 of ADC0.
+#define BOARD_ALTITUDE_ADC \
+    {SYSCTL_PERIPH_ADC0, ADC0_BASE, 3, 0, 0, ADC_CTL_CH9}
+
+// UART0 on PA0 and PA1, connected to the USB debug interface.
+#define BOARD_UART { \
+    SYSCTL_PERIPH_UART0, UART0_BASE,                                    \
+    {SYSCTL_PERIPH_GPIOA, GPIO_PORTA_BASE, GPIO_PIN_0},                 \
+    {SYSCTL_PERIPH_GPIOA, GPIO_PORTA_BASE, GPIO_PIN_1},                 \
+    GPIO_PA0_U0RX, GPIO_PA1_U0TX                                        \
+}
+
+#else
+#error "Unknown BOARD_REVISION"
+#endif
+
+// Indices of the rotors in BOARD_ROTORS.
+enum boardRotors {BOARD_MAIN_ROTOR = 0, BOARD_TAIL_ROTOR, BOARD_NUM_ROTORS};
+
+
+#endif  // BOARD_H_
@@ -12,124 +12,379 @@
 // The buttons are:  UP and DOWN (on the Orbit daughterboard) plus
 // LEFT and RIGHT on the Tiva.
 //
+// Button changes are posted as timestamped events to a queue, which is
+// written only from the button interrupts and read only by one task, so
+// it needs no locking. As well as presses and releases, a button held down
+// produces a hold event followed by auto-repeat events, and pressing a
+// button while others are held produces a chord event.
+//
 // ****************************************************************************
 
 #include <stdint.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
+#include "inc/hw_gpio.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
 #include "driverlib/debug.h"
-#include "inc/tm4c123gh6pm.h"
+#include "board.h"
+#include "inputCapture.h"
+#include "yaw.h"
+#include "clock.h"
+#include "benchmark.h"
+#include "wcet.h"
 
 #include "buttons4.h"
 
 
+// ****************************************************************************
+// Constants
+// ****************************************************************************
+
+// One-shot timer which confirms the button states once the debounce
+// interval has passed since the first edge.
+#define BUT_TIMER_PERIPH    SYSCTL_PERIPH_TIMER2
+#define BUT_TIMER_BASE      TIMER2_BASE
+#define BUT_TIMER           TIMER_A
+#define BUT_TIMER_INT_FLAG  TIMER_TIMA_TIMEOUT
+
+// Periodic timer which times the held buttons, while any are held.
+#define HOLD_TIMER_PERIPH   SYSCTL_PERIPH_TIMER4
+#define HOLD_TIMER_BASE     TIMER4_BASE
+#define HOLD_TIMER          TIMER_A
+#define HOLD_TIMER_INT_FLAG TIMER_TIMA_TIMEOUT
+
+
 // ****************************************************************************
 // Globals to module
 // ****************************************************************************
+static const boardButton_t but_pins[NUM_BUTS] = BOARD_BUTTONS;
+
 static bool but_state[NUM_BUTS];    // Corresponds to the electrical state
-static uint8_t but_count[NUM_BUTS];
-static bool but_flag[NUM_BUTS];
-static bool but_normal[NUM_BUTS];   // Corresponds to the electrical state
+
+// The buttons currently pressed, and those which have been held for the
+// hold time. The time (ms) since each button's last press, hold or repeat
+// event.
+static uint8_t but_pressed = 0;
+static uint8_t but_holding = 0;
+static uint16_t but_held_ms[NUM_BUTS];
+
+static uint16_t but_hold_ms = BUT_HOLD_MS;
+static uint16_t but_repeat_ms = BUT_REPEAT_MS;
+
+// The event queue. The head is only written by the interrupts, which all
+// have the same priority, and the tail only by the task reading events.
+static volatile buttonEvent_t but_events[BUT_EVENT_QUEUE_SIZE];
+static volatile uint16_t but_event_head = 0;
+static volatile uint16_t but_event_tail = 0;
+static uint16_t but_events_dropped = 0;
+
+// Whether the debounce timer is running, and the time of the first edge
+// which started it (units: yaw timer ticks).
+static bool but_debouncing = false;
+static uint32_t but_edge_time;
+
+
+// ****************************************************************************
+// Static function forward declarations
+// ****************************************************************************
+static void buttonsEdgeIntHandler(void);
+static void buttonsDebounceIntHandler(void);
+static void buttonsHoldIntHandler(void);
+static void buttonsIntEnable(bool enabled);
+static void confirmButtons(bool *but_value, uint32_t timestamp);
+static void postEvent(buttonEventType_t type, uint8_t buttons,
+                      uint32_t timestamp);
+static uint16_t buttonPins(bool *but_value);
 
 
 // ****************************************************************************
 // Initialise the variables associated with the set of buttons defined by the
-// constants in buttons4.h
+// constants in buttons4.h, and the edge interrupts and debounce timer.
 // ****************************************************************************
 void initButtons(void) {
     int i;
 
-    // UP button (active HIGH)
-    SysCtlPeripheralEnable(UP_BUT_PERIPH);
-    GPIOPinTypeGPIOInput(UP_BUT_PORT_BASE, UP_BUT_PIN);
-    GPIOPadConfigSet(UP_BUT_PORT_BASE, UP_BUT_PIN, GPIO_STRENGTH_2MA,
-                     GPIO_PIN_TYPE_STD_WPD);
-    but_normal[UP] = UP_BUT_NORMAL;
-
-    // DOWN button (active HIGH)
-    SysCtlPeripheralEnable(DOWN_BUT_PERIPH);
-    GPIOPinTypeGPIOInput(DOWN_BUT_PORT_BASE, DOWN_BUT_PIN);
-    GPIOPadConfigSet(DOWN_BUT_PORT_BASE, DOWN_BUT_PIN, GPIO_STRENGTH_2MA,
-                     GPIO_PIN_TYPE_STD_WPD);
-    but_normal[DOWN] = DOWN_BUT_NORMAL;
-
-    // LEFT button (active LOW)
-    SysCtlPeripheralEnable(LEFT_BUT_PERIPH);
-    GPIOPinTypeGPIOInput(LEFT_BUT_PORT_BASE, LEFT_BUT_PIN);
-    GPIOPadConfigSet(LEFT_BUT_PORT_BASE, LEFT_BUT_PIN, GPIO_STRENGTH_2MA,
-                     GPIO_PIN_TYPE_STD_WPU);
-    but_normal[LEFT] = LEFT_BUT_NORMAL;
-
-    // RIGHT button (active LOW)
-    // Note that PF0 is one of a handful of GPIO pins that need to be
-    // "unlocked" before they can be reconfigured.  This also requires
-    //      #include "inc/tm4c123gh6pm.h"
-    SysCtlPeripheralEnable(RIGHT_BUT_PERIPH);
-    // ---Unlock PF0 for the right button:
-    GPIO_PORTF_LOCK_R = GPIO_LOCK_KEY;
-    GPIO_PORTF_CR_R |= GPIO_PIN_0;  // PF0 unlocked
-    GPIO_PORTF_LOCK_R = GPIO_LOCK_M;
-    GPIOPinTypeGPIOInput(RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN);
-    GPIOPadConfigSet(RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN, GPIO_STRENGTH_2MA,
-                     GPIO_PIN_TYPE_STD_WPU);
-    but_normal[RIGHT] = RIGHT_BUT_NORMAL;
+    for (i = 0; i < NUM_BUTS; i++) {
+        const boardButton_t *but = &but_pins[i];
+
+        SysCtlPeripheralEnable(but->gpio.periph);
 
+        // Note that PD7 and PF0 are GPIO pins that need to be "unlocked"
+        // before they can be reconfigured.
+        if (but->locked) {
+            HWREG(but->gpio.base + GPIO_O_LOCK) = GPIO_LOCK_KEY;
+            HWREG(but->gpio.base + GPIO_O_CR) |= but->gpio.pin;
+            HWREG(but->gpio.base + GPIO_O_LOCK) = 0;
+        }
+
+        GPIOPinTypeGPIOInput(but->gpio.base, but->gpio.pin);
+        GPIOPadConfigSet(but->gpio.base, but->gpio.pin, GPIO_STRENGTH_2MA,
+                         but->padType);
+        but_state[i] = but->normal;
+    }
+
+    // Debounce timer, started by the first edge.
+    SysCtlPeripheralEnable(BUT_TIMER_PERIPH);
+    TimerConfigure(BUT_TIMER_BASE, TIMER_CFG_ONE_SHOT);
+    TimerIntRegister(BUT_TIMER_BASE, BUT_TIMER, buttonsDebounceIntHandler);
+    TimerIntEnable(BUT_TIMER_BASE, BUT_TIMER_INT_FLAG);
+
+    // Hold timer, started while any button is held.
+    SysCtlPeripheralEnable(HOLD_TIMER_PERIPH);
+    TimerConfigure(HOLD_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(HOLD_TIMER_BASE, HOLD_TIMER,
+                 clockRate() / 1000 * BUT_HOLD_TICK_MS - 1);
+    TimerIntRegister(HOLD_TIMER_BASE, HOLD_TIMER, buttonsHoldIntHandler);
+    TimerIntEnable(HOLD_TIMER_BASE, HOLD_TIMER_INT_FLAG);
+
+    // Interrupt on both edges of every button pin.
     for (i = 0; i < NUM_BUTS; i++) {
-        but_state[i] = but_normal[i];
-        but_count[i] = 0;
-        but_flag[i] = false;
+        GPIOIntRegister(but_pins[i].gpio.base, buttonsEdgeIntHandler);
+        GPIOIntTypeSet(but_pins[i].gpio.base, but_pins[i].gpio.pin,
+                       GPIO_BOTH_EDGES);
     }
+    buttonsIntEnable(true);
 }
 
 // ****************************************************************************
-// Function designed to be called regularly. It polls all of the
-// buttons once and updates variables associated with the buttons if
-// necessary.  It is efficient enough to be part of an ISR, e.g. from
-// a SysTick interrupt.
+// The handler for an edge on any button pin. Timestamps the first edge and
+// starts the debounce timer, masking the button interrupts until it
+// expires so that bounces do not cause further interrupts.
+// ****************************************************************************
+static void buttonsEdgeIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_INPUT_EDGE);
+    buttonsIntEnable(false);
+
+    // Another port may already have been pending when the interrupts were
+    // masked, so only the first edge starts the timer.
+    if (!but_debouncing) {
+        but_debouncing = true;
+        but_edge_time = yawTimestamp();
+        TimerLoadSet(BUT_TIMER_BASE, BUT_TIMER,
+                     clockRate() / 1000 * BUT_DEBOUNCE_MS);
+        TimerEnable(BUT_TIMER_BASE, BUT_TIMER);
+    }
+    WCET_ISR_EXIT(WCET_ISR_INPUT_EDGE);
+}
+
+// ****************************************************************************
+// The handler for the debounce timer. Reads the settled button states and
+// unmasks the button interrupts.
+// ****************************************************************************
+static void buttonsDebounceIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_INPUT_DEBOUNCE);
+    TimerIntClear(BUT_TIMER_BASE, BUT_TIMER_INT_FLAG);
+
+    BENCHMARK_START(BENCH_BUTTONS);
+    updateButtons();
+    BENCHMARK_STOP(BENCH_BUTTONS);
+
+    but_debouncing = false;
+    buttonsIntEnable(true);
+    WCET_ISR_EXIT(WCET_ISR_INPUT_DEBOUNCE);
+}
+
+// ****************************************************************************
+// Masks or unmasks the edge interrupts of all the buttons. Edges latched
+// while masked are cleared before unmasking.
+// ****************************************************************************
+static void buttonsIntEnable(bool enabled) {
+    int i;
+
+    for (i = 0; i < NUM_BUTS; i++) {
+        if (enabled) {
+            GPIOIntClear(but_pins[i].gpio.base, but_pins[i].gpio.pin);
+            GPIOIntEnable(but_pins[i].gpio.base, but_pins[i].gpio.pin);
+        } else {
+            GPIOIntDisable(but_pins[i].gpio.base, but_pins[i].gpio.pin);
+        }
+    }
+}
+
+// ****************************************************************************
+// Reads the buttons, with one read of each port, and updates the variables
+// associated with the buttons. Called once the debounce interval has passed
+// since the first edge, so the pins have settled.
 // ****************************************************************************
 void updateButtons(void) {
     bool but_value[NUM_BUTS];
+    uint32_t port_base = 0;
+    uint32_t port_pins = 0;
     int i;
 
-    // Read the pins; true means HIGH, false means LOW
-    but_value[UP] = (GPIOPinRead(UP_BUT_PORT_BASE, UP_BUT_PIN) == UP_BUT_PIN);
-    but_value[DOWN] = (GPIOPinRead(DOWN_BUT_PORT_BASE, DOWN_BUT_PIN) == DOWN_BUT_PIN);
-    but_value[LEFT] = (GPIOPinRead(LEFT_BUT_PORT_BASE, LEFT_BUT_PIN) == LEFT_BUT_PIN);
-    but_value[RIGHT] = (GPIOPinRead(RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN) == RIGHT_BUT_PIN);
+    // Read the pins; true means HIGH, false means LOW. Buttons on the same
+    // port are adjacent, so each port is read once.
+    for (i = 0; i < NUM_BUTS; i++) {
+        if (but_pins[i].gpio.base != port_base) {
+            port_base = but_pins[i].gpio.base;
+            port_pins = GPIOPinRead(port_base, 0xFF);
+        }
+        but_value[i] = ((port_pins & but_pins[i].gpio.pin) != 0);
+    }
+
+    inputCaptureRecordChangeAt(CAPTURE_BUTTONS, buttonPins(but_value),
+                               but_edge_time);
+    confirmButtons(but_value, but_edge_time);
+}
+
+// ****************************************************************************
+// Updates the variables associated with the buttons from the given pin
+// values (true means HIGH). Used when replaying captured button inputs.
+// ****************************************************************************
+void updateButtonsFromValues(bool *but_value) {
+    inputCaptureRecordChange(CAPTURE_BUTTONS, buttonPins(but_value));
+    confirmButtons(but_value, yawTimestamp());
+}
+
+// ****************************************************************************
+// Sets the state of each button from its settled pin value, posting press
+// and release events for the buttons which have changed, and a chord event
+// if a button was pressed while others are held. Runs the hold timer only
+// while a button is held.
+// ****************************************************************************
+static void confirmButtons(bool *but_value, uint32_t timestamp) {
+    uint8_t was_pressed = but_pressed;
+    int i;
 
-    // Iterate through the buttons, updating button variables as required
     for (i = 0; i < NUM_BUTS; i++) {
         if (but_value[i] != but_state[i]) {
-            but_count[i]++;
-            if (but_count[i] >= NUM_BUT_POLLS) {
-                but_state[i] = but_value[i];
-                but_flag[i] = true;    // Reset by call to checkButton()
-                but_count[i] = 0;
+            but_state[i] = but_value[i];
+            if (but_state[i] != but_pins[i].normal) {
+                but_pressed |= BUT_MASK(i);
+                but_holding &= ~BUT_MASK(i);
+                but_held_ms[i] = 0;
+                postEvent(BUT_EVENT_PRESS, BUT_MASK(i), timestamp);
+            } else {
+                but_pressed &= ~BUT_MASK(i);
+                postEvent(BUT_EVENT_RELEASE, BUT_MASK(i), timestamp);
             }
-        } else {
-            but_count[i] = 0;
         }
     }
+
+    // A chord is posted when the set of pressed buttons grows to more
+    // than one.
+    if ((but_pressed & ~was_pressed) && (but_pressed & (but_pressed - 1))) {
+        postEvent(BUT_EVENT_CHORD, but_pressed, timestamp);
+    }
+
+    if (but_pressed && !was_pressed) {
+        TimerEnable(HOLD_TIMER_BASE, HOLD_TIMER);
+    } else if (!but_pressed && was_pressed) {
+        TimerDisable(HOLD_TIMER_BASE, HOLD_TIMER);
+    }
 }
 
 // ****************************************************************************
-// Function which returns the new button state if the button state
-// (PUSHED or RELEASED) has changed since the last call, otherwise returns
-// NO_CHANGE.  The argument butName should be one of constants in the
-// enumeration butStates, excluding 'NUM_BUTS'. Safe under interrupt.
+// The handler for the hold timer. Posts a hold event for each button held
+// for the hold time, and auto-repeat events at the repeat interval after.
 // ****************************************************************************
-buttonState_t checkButton(buttonName_t butName) {
-    if (but_flag[butName]) {
-        but_flag[butName] = false;
-        if (but_state[butName] == but_normal[butName]) {
-            return RELEASED;
-        } else {
-            return PUSHED;
+static void buttonsHoldIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_BUTTON_HOLD);
+    uint32_t timestamp = yawTimestamp();
+    int i;
+
+    TimerIntClear(HOLD_TIMER_BASE, HOLD_TIMER_INT_FLAG);
+
+    for (i = 0; i < NUM_BUTS; i++) {
+        if (!(but_pressed & BUT_MASK(i))) {
+            continue;
         }
+
+        // The held time goes back to zero at each event, so it never
+        // wraps. The times are compared with >=, so that an event is not
+        // missed if buttonsSetHold shortens them while a button is held.
+        but_held_ms[i] += BUT_HOLD_TICK_MS;
+        if (!(but_holding & BUT_MASK(i))) {
+            if (but_held_ms[i] >= but_hold_ms) {
+                but_holding |= BUT_MASK(i);
+                but_held_ms[i] = 0;
+                postEvent(BUT_EVENT_HOLD, BUT_MASK(i), timestamp);
+            }
+        } else if (but_held_ms[i] >= but_repeat_ms) {
+            but_held_ms[i] = 0;
+            postEvent(BUT_EVENT_REPEAT, BUT_MASK(i), timestamp);
+        }
+    }
+    WCET_ISR_EXIT(WCET_ISR_BUTTON_HOLD);
+}
+
+// ****************************************************************************
+// Adds an event to the queue, or drops it if the queue is full. Must only be
+// called from the button interrupts.
+// ****************************************************************************
+static void postEvent(buttonEventType_t type, uint8_t buttons,
+                      uint32_t timestamp) {
+    uint16_t next = (but_event_head + 1) & (BUT_EVENT_QUEUE_SIZE - 1);
+
+    if (next == but_event_tail) {
+        but_events_dropped++;
+        return;
+    }
+
+    but_events[but_event_head].type = type;
+    but_events[but_event_head].buttons = buttons;
+    but_events[but_event_head].timestamp = timestamp;
+
+    // Only publish the event once it has been written.
+    but_event_head = next;
+}
+
+// ****************************************************************************
+// Packs the given pin values into a word, with bit n set if button n is
+// HIGH.
+// ****************************************************************************
+static uint16_t buttonPins(bool *but_value) {
+    uint16_t pins = 0;
+    int i;
+
+    for (i = 0; i < NUM_BUTS; i++) {
+        pins |= but_value[i] << i;
+    }
+    return pins;
+}
+
+// ****************************************************************************
+// Takes the oldest event from the queue into the given event. Returns false
+// if the queue is empty. Must only be called from one task.
+// ****************************************************************************
+bool buttonsGetEvent(buttonEvent_t *event) {
+    uint16_t tail = but_event_tail;
+
+    if (tail == but_event_head) {
+        return false;
     }
-    return NO_CHANGE;
+
+    event->type = but_events[tail].type;
+    event->buttons = but_events[tail].buttons;
+    event->timestamp = but_events[tail].timestamp;
+
+    // Only free the slot once the event has been read.
+    but_event_tail = (tail + 1) & (BUT_EVENT_QUEUE_SIZE - 1);
+    return true;
 }
 
+// ****************************************************************************
+// Returns the number of events dropped because the queue was full.
+// ****************************************************************************
+uint16_t buttonsEventsDropped(void) {
+    return but_events_dropped;
+}
+
+// ****************************************************************************
+// Sets the time (ms) a button must be held for a hold event, and the
+// interval (ms) between auto-repeat events after it. Both are rounded down
+// to a multiple of BUT_HOLD_TICK_MS, of at least one.
+// ****************************************************************************
+void buttonsSetHold(uint16_t hold_ms, uint16_t repeat_ms) {
+    if (hold_ms < BUT_HOLD_TICK_MS) {
+        hold_ms = BUT_HOLD_TICK_MS;
+    }
+    if (repeat_ms < BUT_HOLD_TICK_MS) {
+        repeat_ms = BUT_HOLD_TICK_MS;
+    }
+    but_hold_ms = hold_ms - hold_ms % BUT_HOLD_TICK_MS;
+    but_repeat_ms = repeat_ms - repeat_ms % BUT_HOLD_TICK_MS;
+}
@@ -12,6 +12,12 @@
 // The buttons are:  UP and DOWN (on the Orbit daughterboard) plus
 // LEFT and RIGHT on the Tiva.
 //
+// Button changes are posted as timestamped events to a queue, which is
+// written only from the button interrupts and read only by one task, so
+// it needs no locking. As well as presses and releases, a button held down
+// produces a hold event followed by auto-repeat events, and pressing a
+// button while others are held produces a chord event.
+//
 // ****************************************************************************
 
 #ifndef BUTTONS4_H_
@@ -26,60 +32,84 @@
 // Constants
 //*****************************************************************************
 enum butNames {UP = 0, DOWN, LEFT, RIGHT, NUM_BUTS};
-enum butStates {RELEASED = 0, PUSHED, NO_CHANGE};
+enum butEventTypes {BUT_EVENT_PRESS = 0,
+                    BUT_EVENT_RELEASE,
+                    BUT_EVENT_HOLD,      // Held for the hold time
+                    BUT_EVENT_REPEAT,    // Still held, at the repeat rate
+                    BUT_EVENT_CHORD};    // Pressed while others are held
 
 typedef enum butNames buttonName_t;
-typedef enum butStates buttonState_t;
-
-// UP button
-#define UP_BUT_PERIPH  SYSCTL_PERIPH_GPIOE
-#define UP_BUT_PORT_BASE  GPIO_PORTE_BASE
-#define UP_BUT_PIN  GPIO_PIN_0
-#define UP_BUT_NORMAL  false
-// DOWN button
-#define DOWN_BUT_PERIPH  SYSCTL_PERIPH_GPIOD
-#define DOWN_BUT_PORT_BASE  GPIO_PORTD_BASE
-#define DOWN_BUT_PIN  GPIO_PIN_2
-#define DOWN_BUT_NORMAL  false
-// LEFT button
-#define LEFT_BUT_PERIPH  SYSCTL_PERIPH_GPIOF
-#define LEFT_BUT_PORT_BASE  GPIO_PORTF_BASE
-#define LEFT_BUT_PIN  GPIO_PIN_4
-#define LEFT_BUT_NORMAL  true
-// RIGHT button
-#define RIGHT_BUT_PERIPH  SYSCTL_PERIPH_GPIOF
-#define RIGHT_BUT_PORT_BASE  GPIO_PORTF_BASE
-#define RIGHT_BUT_PIN  GPIO_PIN_0
-#define RIGHT_BUT_NORMAL  true
-
-// Debounce algorithm: A state machine is associated with each button.
-// A state change occurs only after NUM_BUT_POLLS consecutive polls have
-// read the pin in the opposite condition, before the state changes and
-// a flag is set.  Set NUM_BUT_POLLS according to the polling rate.
-#define NUM_BUT_POLLS 3
+typedef enum butEventTypes buttonEventType_t;
+
+// Bit for the given button in the buttons of an event.
+#define BUT_MASK(butName)  (1u << (butName))
+
+// An event, with the button it applies to (or every button pressed, for a
+// chord) and when it happened, in yaw timer ticks. Press and release
+// events are timestamped at the first edge, before debouncing.
+typedef struct {
+    buttonEventType_t type;
+    uint8_t buttons;
+    uint32_t timestamp;
+} buttonEvent_t;
+
+// The pins of the buttons are given by BOARD_BUTTONS in board.h.
+
+// Debounce algorithm: The first edge on any button pin is timestamped and
+// starts a one-shot timer, and the button interrupts are masked. When the
+// timer expires, BUT_DEBOUNCE_MS later, the settled pins are read, the
+// state of any button which has changed is updated and a flag is set, and
+// the interrupts are unmasked.
+#define BUT_DEBOUNCE_MS 10
+
+// Default time a button must be held for a hold event, and the interval
+// between auto-repeat events after it. Held buttons are timed in steps of
+// BUT_HOLD_TICK_MS, by a periodic timer which only runs while a button is
+// held.
+#define BUT_HOLD_MS 500
+#define BUT_REPEAT_MS 100
+#define BUT_HOLD_TICK_MS 10
+
+// Number of events the queue can hold. Must be a power of two.
+#define BUT_EVENT_QUEUE_SIZE 16
 
 
 // ****************************************************************************
-// Initialise the variables associated with the set of buttons defined by the
-// constants above.
+// Initialise the variables associated with the set of buttons defined in
+// board.h, and the edge interrupts and debounce timer.
 // ****************************************************************************
 void initButtons(void);
 
 // ****************************************************************************
-// Function designed to be called regularly. It polls all of the
-// buttons once and updates variables associated with the buttons if
-// necessary.  It is efficient enough to be part of an ISR, e.g. from
-// a SysTick interrupt.
+// Reads the buttons, with one read of each port, and updates the variables
+// associated with the buttons. Called once the debounce interval has passed
+// since the first edge, so the pins have settled.
 // ****************************************************************************
 void updateButtons(void);
 
 // ****************************************************************************
-// Function returns the new button state if the button state
-// (PUSHED or RELEASED) has changed since the last call, otherwise returns
-// NO_CHANGE.  The argument butName should be one of constants in the
-// enumeration butStates, excluding 'NUM_BUTS'. Safe under interrupt.
+// Updates the variables associated with the buttons from the given pin
+// values (true means HIGH). Used when replaying captured button inputs.
+// ****************************************************************************
+void updateButtonsFromValues(bool *but_value);
+
+// ****************************************************************************
+// Takes the oldest event from the queue into the given event. Returns false
+// if the queue is empty. Must only be called from one task.
+// ****************************************************************************
+bool buttonsGetEvent(buttonEvent_t *event);
+
+// ****************************************************************************
+// Returns the number of events dropped because the queue was full.
+// ****************************************************************************
+uint16_t buttonsEventsDropped(void);
+
+// ****************************************************************************
+// Sets the time (ms) a button must be held for a hold event, and the
+// interval (ms) between auto-repeat events after it. Both are rounded down
+// to a multiple of BUT_HOLD_TICK_MS, of at least one.
 // ****************************************************************************
-buttonState_t checkButton(buttonName_t butName);
+void buttonsSetHold(uint16_t hold_ms, uint16_t repeat_ms);
 
 
 #endif  // BUTTONS4_H_
@@ -0,0 +1,60 @@
+//*****************************************************************************
+//
+// File: clock.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module for configuring the system clock. The clock rate is chosen at
+// compile time from one of a fixed set of profiles, and cached when the
+// clock is initialised, so that other modules can derive their timing
+// from it without querying the hardware each time.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/sysctl.h"
+
+#include "clock.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Divider applied to the 200MHz PLL output to give the profile's rate.
+#if CLOCK_PROFILE_MHZ == 20
+#define CLOCK_SYSDIV        SYSCTL_SYSDIV_10
+#elif CLOCK_PROFILE_MHZ == 40
+#define CLOCK_SYSDIV        SYSCTL_SYSDIV_5
+#elif CLOCK_PROFILE_MHZ == 50
+#define CLOCK_SYSDIV        SYSCTL_SYSDIV_4
+#else
+#define CLOCK_SYSDIV        SYSCTL_SYSDIV_2_5
+#endif
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+static uint32_t clockRateHz;
+
+
+//*****************************************************************************
+// Sets the system clock to the rate of the selected profile, running from
+// the PLL and the 16MHz crystal.
+//*****************************************************************************
+void initClock(void) {
+    SysCtlClockSet(CLOCK_SYSDIV | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
+                   SYSCTL_XTAL_16MHZ);
+    clockRateHz = CLOCK_RATE_HZ;
+}
+
+//*****************************************************************************
+// Returns the system clock rate in Hz, as cached by initClock.
+//*****************************************************************************
+uint32_t clockRate(void) {
+    return clockRateHz;
+}
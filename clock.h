@@ -0,0 +1,51 @@
+//*****************************************************************************
+//
+// File: clock.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module for configuring the system clock. The clock rate is chosen at
+// compile time from one of a fixed set of profiles, and cached when the
+// clock is initialised, so that other modules can derive their timing
+// from it without querying the hardware each time.
+//
+//*****************************************************************************
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+
+//*****************************************************************************
+// Public constants
+//*****************************************************************************
+
+// The clock profile, in MHz. Must be one of 20, 40, 50 or 80. May be
+// overridden in the build configuration.
+#ifndef CLOCK_PROFILE_MHZ
+#define CLOCK_PROFILE_MHZ   80
+#endif
+
+#if CLOCK_PROFILE_MHZ != 20 && CLOCK_PROFILE_MHZ != 40 && \
+    CLOCK_PROFILE_MHZ != 50 && CLOCK_PROFILE_MHZ != 80
+#error "CLOCK_PROFILE_MHZ must be 20, 40, 50 or 80"
+#endif
+
+// The system clock rate, in Hz.
+#define CLOCK_RATE_HZ       (CLOCK_PROFILE_MHZ * 1000000UL)
+
+
+//*****************************************************************************
+// Sets the system clock to the rate of the selected profile, running from
+// the PLL and the 16MHz crystal.
+//*****************************************************************************
+void initClock(void);
+
+//*****************************************************************************
+// Returns the system clock rate in Hz, as cached by initClock.
+//*****************************************************************************
+uint32_t clockRate(void);
+
+
+#endif  // CLOCK_H_
@@ -12,9 +12,22 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
 #include "altitude.h"
 #include "yaw.h"
 #include "rotors.h"
+#include "vehicleState.h"
+#include "flightRecorder.h"
+#include "flightLog.h"
+#include "benchmark.h"
+#include "wcet.h"
+#include "clock.h"
+#include "flightState.h"
 
 #include "control.h"
 
@@ -23,8 +36,8 @@
 // Constants
 //*****************************************************************************
 
-// PID gains for the altitude and the yaw. Stored as ten times their actual
-// values to avoid floating-point arithmetic.
+// Default PID gains for the altitude and the yaw, in CONTROL_GAIN_SCALE
+// units. May be changed at run time with controlSetGains.
 #define CONTROL_KP_ALTITUDE         6
 #define CONTROL_KD_ALTITUDE         1
 #define CONTROL_KI_ALTITUDE         2
@@ -32,97 +45,424 @@
 #define CONTROL_KD_YAW              3
 #define CONTROL_KI_YAW              3
 
+// Feedforward for the main rotor. The hover duty is added to the main rotor
+// output, and is learned from the altitude integrator once the altitude has
+// been steady for CONTROL_STEADY_STATE_UPDATES consecutive updates
+// (half a second), by moving whole percents of the integral term into it.
+#define CONTROL_HOVER_DUTY_INITIAL  30      // Units: %
+#define CONTROL_HOVER_DUTY_MAX      PWM_MAX_DUTY
+#define CONTROL_STEADY_STATE_ERROR  1       // Units: %
+#define CONTROL_STEADY_STATE_UPDATES(rate)  ((rate) / 2)
+
+// Default main to tail rotor coupling gain, in CONTROL_GAIN_SCALE units.
+// May be changed at run time with controlSetCoupling.
+#define CONTROL_MAIN_TAIL_COUPLING  8
+
+// The control loop is run from a dedicated timer interrupt. Its priority is
+// set below that of the yaw and ADC interrupts (which default to the highest
+// priority, 0), so that no yaw edges are missed while the controller runs.
+#define CONTROL_TIMER_PERIPH        SYSCTL_PERIPH_TIMER0
+#define CONTROL_TIMER_BASE          TIMER0_BASE
+#define CONTROL_TIMER               TIMER_A
+#define CONTROL_TIMER_INT           INT_TIMER0A
+#define CONTROL_TIMER_INT_FLAG      TIMER_TIMA_TIMEOUT
+#define CONTROL_INT_PRIORITY        0x20
+
 
 //*****************************************************************************
 // Static variables
 //*****************************************************************************
-static int16_t controlUpdateRate;
+// The controller run from the control timer.
+static controller_t controller;
 
-static int16_t altitudeErrorPrevious = 0;        // Units: %
-static int32_t altitudeErrorIntegrated = 0;      // Units: 0.01%
+// Number of control updates which did not finish before the next one was
+// due.
+static volatile uint32_t numOverruns = 0;
 
-static int16_t yawErrorPrevious = 0;             // Units: deg
-static int32_t yawErrorIntegrated = 0;           // Units: 0.01 deg
 
 
 //*****************************************************************************
 // Static function forward declarations
 //*****************************************************************************
-static void controlUpdateAltitude(void);
-static void controlUpdateYaw(void);
+static void controlIntHandler(void);
+static void controlUpdateAltitude(controller_t* controller,
+                                  vehicleState_t* state);
+static void controlUpdateYaw(controller_t* controller, vehicleState_t* state);
+static void controlLearnHoverDuty(controller_t* controller,
+                                  vehicleState_t* state, int16_t error,
+                                  int32_t errorDerivative);
+
+
+//*****************************************************************************
+// Initialise the control module, configuring a periodic timer interrupt
+// which will run the control update at the given rate (in Hz).
+// The timer is not started until controlStart is called.
+//*****************************************************************************
+void initControl(uint16_t updateRate) {
+    controllerInit(&controller, updateRate);
+
+    SysCtlPeripheralEnable(CONTROL_TIMER_PERIPH);
+    TimerConfigure(CONTROL_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerLoadSet(CONTROL_TIMER_BASE, CONTROL_TIMER,
+                 clockRate() / updateRate - 1);
+
+    TimerIntRegister(CONTROL_TIMER_BASE, CONTROL_TIMER, controlIntHandler);
+    IntPrioritySet(CONTROL_TIMER_INT, CONTROL_INT_PRIORITY);
+    TimerIntEnable(CONTROL_TIMER_BASE, CONTROL_TIMER_INT_FLAG);
+}
+
+//*****************************************************************************
+// Resets a controller instance to its initial state, for the given update
+// rate (in Hz).
+//*****************************************************************************
+void controllerInit(controller_t* controller, uint16_t updateRate) {
+    controller->updateRate = updateRate;
+    controller->altitudeGains.kp = CONTROL_KP_ALTITUDE;
+    controller->altitudeGains.ki = CONTROL_KI_ALTITUDE;
+    controller->altitudeGains.kd = CONTROL_KD_ALTITUDE;
+    controller->yawGains.kp = CONTROL_KP_YAW;
+    controller->yawGains.ki = CONTROL_KI_YAW;
+    controller->yawGains.kd = CONTROL_KD_YAW;
+    controller->altitudeErrorIntegrated = 0;
+    controller->yawErrorIntegrated = 0;
+    controller->feedforwardEnabled = true;
+    controller->couplingGain = CONTROL_MAIN_TAIL_COUPLING;
+    controller->hoverDuty = CONTROL_HOVER_DUTY_INITIAL;
+    controller->couplingDuty = 0;
+    controller->steadyUpdates = 0;
+    controller->numUpdates = 0;
+    controller->altitudeSaturated = false;
+    controller->yawSaturated = false;
+    controller->record = NULL;
+}
+
+//*****************************************************************************
+// Sets the altitude and yaw gains of a controller instance, resetting its
+// integrators, which were accumulated for the previous integral gains.
+//*****************************************************************************
+void controllerSetGains(controller_t* controller,
+                        const controlGains_t* altitudeGains,
+                        const controlGains_t* yawGains) {
+    controller->altitudeGains = *altitudeGains;
+    controller->yawGains = *yawGains;
+    controller->altitudeErrorIntegrated = 0;
+    controller->yawErrorIntegrated = 0;
+}
 
+//*****************************************************************************
+// Sets the altitude and yaw gains of the controller run from the control
+// timer, e.g. to try gains on the rig without rebuilding. Takes effect at
+// the next control update.
+//*****************************************************************************
+void controlSetGains(const controlGains_t* altitudeGains,
+                     const controlGains_t* yawGains) {
+    // The gains are changed together, so that no update uses a mix.
+    bool interruptsDisabled = IntMasterDisable();
+    controllerSetGains(&controller, altitudeGains, yawGains);
+    if (!interruptsDisabled) {
+        IntMasterEnable();
+    }
+}
+
+//*****************************************************************************
+// Starts the control timer. Should be called once the altitude reference
+// has been set, so that the first errors calculated are meaningful.
+//*****************************************************************************
+void controlStart(void) {
+    TimerEnable(CONTROL_TIMER_BASE, CONTROL_TIMER);
+}
 
 //*****************************************************************************
-// Initialise the control module.
+// The handler for the control timer interrupt.
 //*****************************************************************************
-void initControl(int16_t updateRate) {
-    controlUpdateRate = updateRate;
+static void controlIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_CONTROL);
+    TimerIntClear(CONTROL_TIMER_BASE, CONTROL_TIMER_INT_FLAG);
+
+    BENCHMARK_START(BENCH_CONTROL);
+    controlUpdate(&controller);
+    BENCHMARK_STOP(BENCH_CONTROL);
+
+    // If the timer has already timed out again, this update overran.
+    if (TimerIntStatus(CONTROL_TIMER_BASE, false) & CONTROL_TIMER_INT_FLAG) {
+        numOverruns++;
+    }
+    WCET_ISR_EXIT(WCET_ISR_CONTROL);
 }
 
 //*****************************************************************************
-// Updates the main and tail motor duty cylces, based on the current altitude
-// and yaw errors.
+// Runs one update of the given controller, updating the main and tail motor
+// duty cylces based on the current altitude and yaw errors. Both are
+// calculated from the same snapshot of the helicopter state.
 //*****************************************************************************
-void controlUpdate(void) {
-    controlUpdateAltitude();
-    controlUpdateYaw();
+void controlUpdate(controller_t* controller) {
+    vehicleState_t state;
+
+    // The flight state is updated first, as entering a state can move the
+    // yaw reference frame and publish a new snapshot.
+    flightStateUpdate(controller->updateRate);
+    vehicleStateGet(&state);
+
+    flightRecorderUpdate(state.flightState);
+    flightRecord_t* record = flightRecorderNext();
+    controller->record = record;
+    if (record != NULL) {
+        record->timestamp = controller->numUpdates;
+        record->meanADC = state.meanADC;
+        record->yawCount = state.yawCount;
+        record->desiredAltitude = state.desiredAltitude;
+        record->desiredYaw = state.desiredYaw;
+        record->flightState = state.flightState;
+    }
+    controller->numUpdates++;
+
+    altitudeUpdateReference(controller->updateRate);
+    yawUpdateReference(controller->updateRate);
+
+    controlUpdateAltitude(controller, &state);
+    controlUpdateYaw(controller, &state);
+
+    // Latch the new duty cycles of both rotors together.
+    rotorsUpdate();
+
+    flightLogUpdate(&state);
 }
 
 //*****************************************************************************
 // Update the main motor duty cycle based on the current altitude and the
 // desired altitude.
 //*****************************************************************************
-static void controlUpdateAltitude(void) {
-    int16_t error = altitudeError();
-    int16_t errorDerivative = (error - altitudeErrorPrevious)
-                               * controlUpdateRate;
-    int32_t newIntegratedError = altitudeErrorIntegrated
-                                  + error * 100 / controlUpdateRate;
+static void controlUpdateAltitude(controller_t* controller,
+                                  vehicleState_t* state) {
+    int16_t error = altitudeReference() - state->altitude;
+    // The derivative is taken on the estimated altitude rather than the
+    // error, as the reference changes smoothly. Units: % / s
+    int32_t errorDerivative = -state->altitudeRate / 100;
+    int32_t newIntegratedError = controller->altitudeErrorIntegrated + error;
 
-    int16_t mainRotorDuty = (CONTROL_KP_ALTITUDE * error * 100
-                             + CONTROL_KD_ALTITUDE * errorDerivative * 100
-                             + CONTROL_KI_ALTITUDE * newIntegratedError) / 1000;
+    const controlGains_t* gains = &controller->altitudeGains;
 
-    altitudeErrorPrevious = error;
+    int32_t proportional = gains->kp * error;
+    int32_t integral = gains->ki * newIntegratedError / controller->updateRate;
+    int32_t derivative = gains->kd * errorDerivative;
+    // Units: 1 / PWM_DUTY_SCALE %
+    int32_t mainRotorDuty = (proportional + integral + derivative)
+                            * PWM_DUTY_SCALE / CONTROL_GAIN_SCALE;
 
-    if (mainRotorDuty > PWM_MAX_DUTY && error > 0) {
-        mainRotorDuty = PWM_MAX_DUTY;
-    } else if (mainRotorDuty < PWM_MAIN_MIN_DUTY && error < 0) {
-        mainRotorDuty = PWM_MAIN_MIN_DUTY;
-    } else {
-        // Only accumulate error signal if output is within its limits,
-        // to prevent integral windup.
-        altitudeErrorIntegrated = newIntegratedError;
+    if (controller->feedforwardEnabled) {
+        mainRotorDuty += controller->hoverDuty * PWM_DUTY_SCALE;
+    }
+
+    // The duty is saturated before it is narrowed for the rotor, and only
+    // counts as limited if the error is pushing it further out of range.
+    bool limited = false;
+    if (mainRotorDuty > PWM_MAX_DUTY * PWM_DUTY_SCALE) {
+        mainRotorDuty = PWM_MAX_DUTY * PWM_DUTY_SCALE;
+        limited = error > 0;
+    } else if (mainRotorDuty < PWM_MAIN_MIN_DUTY * PWM_DUTY_SCALE) {
+        mainRotorDuty = PWM_MAIN_MIN_DUTY * PWM_DUTY_SCALE;
+        limited = error < 0;
+    }
+
+    BENCHMARK_START(BENCH_ROTOR_SET);
+    int16_t appliedDuty = setMainRotorDuty(mainRotorDuty);
+    BENCHMARK_STOP(BENCH_ROTOR_SET);
+
+    // The rotor may also hold the duty cycle back by its slew limit.
+    if ((appliedDuty < mainRotorDuty && error > 0)
+            || (appliedDuty > mainRotorDuty && error < 0)) {
+        limited = true;
+    }
+
+    // Only accumulate error signal if output is within its limits,
+    // to prevent integral windup.
+    controller->altitudeSaturated = limited;
+    if (!limited) {
+        controller->altitudeErrorIntegrated = newIntegratedError;
+    }
+
+    if (controller->feedforwardEnabled) {
+        controlLearnHoverDuty(controller, state, error, errorDerivative);
+    }
+
+    flightRecord_t* record = controller->record;
+    if (record != NULL) {
+        record->altitudeTerms[0] = flightRecorderTerm(proportional
+                                                      / CONTROL_GAIN_SCALE);
+        record->altitudeTerms[1] = flightRecorderTerm(integral
+                                                      / CONTROL_GAIN_SCALE);
+        record->altitudeTerms[2] = flightRecorderTerm(derivative
+                                                      / CONTROL_GAIN_SCALE);
+        record->mainRotorPower = getMainRotorPower();
+    }
+}
+
+//*****************************************************************************
+// Once the altitude has been steady for long enough while flying, moves any
+// whole percents of the altitude integral term into the hover duty, so that
+// the integrator does not have to wind up to the hover duty on every takeoff.
+//*****************************************************************************
+static void controlLearnHoverDuty(controller_t* controller,
+                                  vehicleState_t* state, int16_t error,
+                                  int32_t errorDerivative) {
+    // The integrated error corresponding to 1% of main rotor duty. Without
+    // an integral term (or with one so large that 1% is less than one unit
+    // of integrated error) there is nothing to learn from.
+    int32_t integratedPerPercent = 0;
+    if (controller->altitudeGains.ki > 0) {
+        integratedPerPercent = (int32_t) controller->updateRate
+                               * CONTROL_GAIN_SCALE
+                               / controller->altitudeGains.ki;
+    }
+
+    if (integratedPerPercent <= 0
+            || state->flightState != FLYING
+            || error > CONTROL_STEADY_STATE_ERROR
+            || error < -CONTROL_STEADY_STATE_ERROR
+            || errorDerivative != 0) {
+        controller->steadyUpdates = 0;
+        return;
+    }
+
+    if (controller->steadyUpdates
+            < CONTROL_STEADY_STATE_UPDATES(controller->updateRate)) {
+        controller->steadyUpdates++;
+        return;
     }
 
-    setMainRotorPower(mainRotorDuty);
+    if (controller->altitudeErrorIntegrated >= integratedPerPercent
+            && controller->hoverDuty < CONTROL_HOVER_DUTY_MAX) {
+        controller->hoverDuty++;
+        controller->altitudeErrorIntegrated -= integratedPerPercent;
+    } else if (controller->altitudeErrorIntegrated <= -integratedPerPercent
+            && controller->hoverDuty > 0) {
+        controller->hoverDuty--;
+        controller->altitudeErrorIntegrated += integratedPerPercent;
+    }
 }
 
 //*****************************************************************************
 // Update the tail motor duty cycle based on the current yaw and the
 // desired yaw.
 //*****************************************************************************
-static void controlUpdateYaw(void) {
-    int16_t error = yawError();
-    int16_t errorDerivative = (error - yawErrorPrevious) * controlUpdateRate;
-    int32_t newIntegratedError = yawErrorIntegrated
-                                  + error * 100 / controlUpdateRate;
+static void controlUpdateYaw(controller_t* controller, vehicleState_t* state) {
+    int16_t error = convertYawToRange(yawReference() - state->yaw);
+    // The derivative is taken on the yaw rate measured from the yaw edge
+    // timestamps rather than the error, as the reference changes smoothly.
+    // Units: deg / s
+    int32_t errorDerivative = -state->yawRate / 100;
+    int32_t newIntegratedError = controller->yawErrorIntegrated + error;
 
-    int16_t tailRotorDuty = (CONTROL_KP_YAW * error * 100
-                             + CONTROL_KD_YAW * errorDerivative * 100
-                             + CONTROL_KI_YAW * newIntegratedError) / 1000;
+    const controlGains_t* gains = &controller->yawGains;
 
-    yawErrorPrevious = error;
+    int32_t proportional = gains->kp * error;
+    int32_t integral = gains->ki * newIntegratedError / controller->updateRate;
+    int32_t derivative = gains->kd * errorDerivative;
+    // Units: 1 / PWM_DUTY_SCALE %
+    int32_t tailRotorDuty = (proportional + integral + derivative)
+                            * PWM_DUTY_SCALE / CONTROL_GAIN_SCALE;
 
-    if (tailRotorDuty > PWM_MAX_DUTY && error > 0) {
-        tailRotorDuty = PWM_MAX_DUTY;
-    } else if (tailRotorDuty < PWM_TAIL_MIN_DUTY && error < 0) {
-        tailRotorDuty = PWM_TAIL_MIN_DUTY;
+    if (controller->feedforwardEnabled) {
+        int32_t coupling = getMainRotorDuty() * controller->couplingGain
+                           / CONTROL_GAIN_SCALE;
+        tailRotorDuty += coupling;
+        controller->couplingDuty = coupling / PWM_DUTY_SCALE;
     } else {
-        // Only accumulate error signal if output is within its limits,
-        // to prevent integral windup.
-        yawErrorIntegrated = newIntegratedError;
+        controller->couplingDuty = 0;
+    }
+
+    // The duty is saturated before it is narrowed for the rotor, and only
+    // counts as limited if the error is pushing it further out of range.
+    bool limited = false;
+    if (tailRotorDuty > PWM_MAX_DUTY * PWM_DUTY_SCALE) {
+        tailRotorDuty = PWM_MAX_DUTY * PWM_DUTY_SCALE;
+        limited = error > 0;
+    } else if (tailRotorDuty < PWM_TAIL_MIN_DUTY * PWM_DUTY_SCALE) {
+        tailRotorDuty = PWM_TAIL_MIN_DUTY * PWM_DUTY_SCALE;
+        limited = error < 0;
     }
 
-    setTailRotorPower(tailRotorDuty);
+    int16_t appliedDuty = setTailRotorDuty(tailRotorDuty);
+
+    // The rotor may also hold the duty cycle back by its slew limit.
+    if ((appliedDuty < tailRotorDuty && error > 0)
+            || (appliedDuty > tailRotorDuty && error < 0)) {
+        limited = true;
+    }
+
+    // Only accumulate error signal if output is within its limits,
+    // to prevent integral windup.
+    controller->yawSaturated = limited;
+    if (!limited) {
+        controller->yawErrorIntegrated = newIntegratedError;
+    }
+
+    flightRecord_t* record = controller->record;
+    if (record != NULL) {
+        record->yawTerms[0] = flightRecorderTerm(proportional
+                                                 / CONTROL_GAIN_SCALE);
+        record->yawTerms[1] = flightRecorderTerm(integral / CONTROL_GAIN_SCALE);
+        record->yawTerms[2] = flightRecorderTerm(derivative
+                                                 / CONTROL_GAIN_SCALE);
+        record->tailRotorPower = getTailRotorPower();
+    }
+}
+
+//*****************************************************************************
+// Enables or disables the hover and main to tail coupling feedforward terms.
+//*****************************************************************************
+void controlSetFeedforward(bool enabled) {
+    controller.feedforwardEnabled = enabled;
+}
+
+//*****************************************************************************
+// Sets the main to tail coupling gain of the controller run from the
+// control timer, in CONTROL_GAIN_SCALE units. Takes effect at the next
+// control update.
+//*****************************************************************************
+void controlSetCoupling(int16_t gain) {
+    controller.couplingGain = gain;
+}
+
+//*****************************************************************************
+// Returns the current (learned) hover duty feedforward, as a percent.
+//*****************************************************************************
+int16_t controlHoverDuty(void) {
+    return controller.hoverDuty;
+}
+
+//*****************************************************************************
+// Returns the main to tail coupling term last added to the tail rotor duty,
+// as a percent.
+//*****************************************************************************
+int16_t controlCouplingDuty(void) {
+    return controller.couplingDuty;
+}
+
+//*****************************************************************************
+// Returns the number of control updates run since the control timer was
+// started. Wraps at 2^16.
+//*****************************************************************************
+uint16_t controlUpdateCount(void) {
+    return controller.numUpdates;
+}
+
+//*****************************************************************************
+// Returns the number of control updates which did not finish before the
+// next one was due.
+//*****************************************************************************
+uint32_t controlOverrunCount(void) {
+    return numOverruns;
+}
+
+//*****************************************************************************
+// Returns whether the altitude or yaw output was limited at the last
+// control update, holding its integrator.
+//*****************************************************************************
+bool controlAltitudeSaturated(void) {
+    return controller.altitudeSaturated;
+}
+
+bool controlYawSaturated(void) {
+    return controller.yawSaturated;
 }
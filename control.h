@@ -13,17 +13,145 @@
 #ifndef CONTROL_H_
 #define CONTROL_H_
 
+#include "flightRecorder.h"
 
 //*****************************************************************************
-// Initialise the control module.
+// PID gains for one axis, stored as CONTROL_GAIN_SCALE times their actual
+// values to avoid floating-point arithmetic.
 //*****************************************************************************
-void initControl(int16_t updateRate);
+#define CONTROL_GAIN_SCALE  10
+
+typedef struct {
+    int16_t kp;
+    int16_t ki;
+    int16_t kd;
+} controlGains_t;
+
+//*****************************************************************************
+// The state of the altitude and yaw controller, gathered into one structure
+// so that it can be reset and inspected as a whole. The firmware runs a
+// single instance from the control timer. Only one instance can be run, as
+// each update also advances the flight state machine, the flight recorder
+// and the reference trajectories, and drives the rotors.
+//*****************************************************************************
+typedef struct {
+    uint16_t updateRate;                // Units: Hz
+    controlGains_t altitudeGains;
+    controlGains_t yawGains;
+
+    // The integrated errors are stored as the sum of the error over all
+    // control updates, and only divided by the update rate when the output
+    // is calculated, so that no precision is lost at high update rates.
+    int32_t altitudeErrorIntegrated;    // Units: % * update periods
+    int32_t yawErrorIntegrated;         // Units: deg * update periods
+
+    // Whether the hover and coupling feedforward terms are applied. The tail
+    // rotor output includes the main rotor duty times the coupling gain, to
+    // counteract the torque of the main rotor before it disturbs the yaw.
+    bool feedforwardEnabled;
+    int16_t couplingGain;               // Units: CONTROL_GAIN_SCALE
+    int16_t hoverDuty;                  // Units: %
+    int16_t couplingDuty;               // Units: %
+
+    // Number of consecutive updates for which the altitude has been steady.
+    uint16_t steadyUpdates;
+
+    // Number of control updates run, used to timestamp flight records.
+    uint16_t numUpdates;
+
+    // Whether the altitude and yaw outputs were limited at the last update,
+    // in which case their integrators are held.
+    bool altitudeSaturated;
+    bool yawSaturated;
+
+    // The flight record for the current update, or NULL if not recording.
+    flightRecord_t* record;
+} controller_t;
+
+//*****************************************************************************
+// Resets a controller instance to its initial state, for the given update
+// rate (in Hz).
+//*****************************************************************************
+void controllerInit(controller_t* controller, uint16_t updateRate);
+
+//*****************************************************************************
+// Sets the altitude and yaw gains of a controller instance, resetting its
+// integrators, which were accumulated for the previous integral gains.
+//*****************************************************************************
+void controllerSetGains(controller_t* controller,
+                        const controlGains_t* altitudeGains,
+                        const controlGains_t* yawGains);
+
+
+//*****************************************************************************
+// Initialise the control module, configuring a periodic timer interrupt
+// which will run the control update at the given rate (in Hz).
+// The timer is not started until controlStart is called.
+//*****************************************************************************
+void initControl(uint16_t updateRate);
+
+//*****************************************************************************
+// Starts the control timer. Should be called once the altitude reference
+// has been set, so that the first errors calculated are meaningful.
+//*****************************************************************************
+void controlStart(void);
+
+//*****************************************************************************
+// Runs one update of the given controller, updating the main and tail motor
+// duty cylces based on the current altitude and yaw errors. Called from the
+// control timer interrupt.
+//*****************************************************************************
+void controlUpdate(controller_t* controller);
+
+//*****************************************************************************
+// Sets the altitude and yaw gains of the controller run from the control
+// timer, e.g. to try gains on the rig without rebuilding. Takes effect at
+// the next control update.
+//*****************************************************************************
+void controlSetGains(const controlGains_t* altitudeGains,
+                     const controlGains_t* yawGains);
+
+//*****************************************************************************
+// Enables or disables the hover and main to tail coupling feedforward terms.
+//*****************************************************************************
+void controlSetFeedforward(bool enabled);
+
+//*****************************************************************************
+// Sets the main to tail coupling gain of the controller run from the
+// control timer, in CONTROL_GAIN_SCALE units. Takes effect at the next
+// control update.
+//*****************************************************************************
+void controlSetCoupling(int16_t gain);
+
+//*****************************************************************************
+// Returns the current (learned) hover duty feedforward, as a percent.
+//*****************************************************************************
+int16_t controlHoverDuty(void);
+
+//*****************************************************************************
+// Returns the main to tail coupling term last added to the tail rotor duty,
+// as a percent.
+//*****************************************************************************
+int16_t controlCouplingDuty(void);
+
+//*****************************************************************************
+// Returns the number of control updates run since the control timer was
+// started. Wraps at 2^16.
+//*****************************************************************************
+uint16_t controlUpdateCount(void);
+
+//*****************************************************************************
+// Returns the number of control updates which did not finish before the
+// next one was due.
+//*****************************************************************************
+uint32_t controlOverrunCount(void);
 
 //*****************************************************************************
-// Updates the main and tail motor duty cylces, based on the current altitude
-// and yaw errors.
+// Returns whether the altitude or yaw output was limited at the last
+// control update, holding its integrator.
 //*****************************************************************************
-void controlUpdate(void);
+bool controlAltitudeSaturated(void);
+bool controlYawSaturated(void);
 
 
 #endif  // CONTROL_H_
@@ -0,0 +1,36 @@
+//*****************************************************************************
+//
+// File: cycleCounter.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Access to the DWT cycle counter of the Cortex-M4, which counts processor
+// clock cycles and is used to measure execution times.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+
+#include "cycleCounter.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Debug registers used to enable the cycle counter.
+#define DEMCR                   (*(volatile uint32_t*) 0xE000EDFC)
+#define DEMCR_TRCENA            0x01000000
+#define DWT_CTRL                (*(volatile uint32_t*) 0xE0001000)
+#define DWT_CTRL_CYCCNTENA      0x00000001
+
+
+//*****************************************************************************
+// Enables the cycle counter. Safe to call more than once.
+//*****************************************************************************
+void initCycleCounter(void) {
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
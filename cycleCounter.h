@@ -0,0 +1,30 @@
+//*****************************************************************************
+//
+// File: cycleCounter.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Access to the DWT cycle counter of the Cortex-M4, which counts processor
+// clock cycles and is used to measure execution times.
+//
+//*****************************************************************************
+
+#ifndef CYCLECOUNTER_H_
+#define CYCLECOUNTER_H_
+
+
+// The current value of the cycle counter. Wraps around, so differences
+// between two readings are correct as long as they are taken less than
+// 2^32 cycles apart.
+#define CYCLE_COUNTER   (*(volatile uint32_t*) 0xE0001004)
+
+
+//*****************************************************************************
+// Enables the cycle counter. Safe to call more than once.
+//*****************************************************************************
+void initCycleCounter(void);
+
+
+#endif  // CYCLECOUNTER_H_
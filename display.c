@@ -15,9 +15,8 @@
 #include <stdbool.h>
 #include "utils/ustdlib.h"
 #include "OrbitOLED/OrbitOLEDInterface.h"
-#include "altitude.h"
-#include "yaw.h"
-#include "rotors.h"
+#include "vehicleState.h"
+#include "benchmark.h"
 
 #include "display.h"
 
@@ -41,16 +40,25 @@ void initDisplay(void) {
 //*****************************************************************************
 void displayUpdate(void) {
     char line[MAX_STR_LEN + 1];
+    vehicleState_t state;
+    vehicleStateGet(&state);
 
-    usnprintf(line, sizeof(line), "Alt: %5d%%", altitudePercent());
+    BENCHMARK_START(BENCH_FORMAT);
+    usnprintf(line, sizeof(line), "Alt:%4d%% %4d/s",
+              state.altitude, state.altitudeRate / 100);
+    BENCHMARK_STOP(BENCH_FORMAT);
+
+    BENCHMARK_START(BENCH_OLED_DRAW);
     OLEDStringDraw(line, 0, 0);
+    BENCHMARK_STOP(BENCH_OLED_DRAW);
 
-    usnprintf(line, sizeof(line), "Yaw: %5d deg", yawDegrees());
+    usnprintf(line, sizeof(line), "Yaw:%4d %5d/s",
+              state.yaw, state.yawRate / 100);
     OLEDStringDraw(line, 0, 1);
 
-    usnprintf(line, sizeof(line), "Main: %4d%%", getMainRotorPower());
+    usnprintf(line, sizeof(line), "Main: %4d%%", state.mainRotorPower);
     OLEDStringDraw(line, 0, 2);
 
-    usnprintf(line, sizeof(line), "Tail: %4d%%", getTailRotorPower());
+    usnprintf(line, sizeof(line), "Tail: %4d%%", state.tailRotorPower);
     OLEDStringDraw(line, 0, 3);
 }
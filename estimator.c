@@ -0,0 +1,128 @@
+//*****************************************************************************
+//
+// File: estimator.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which estimates the vertical rate of the helicopter, using a
+// fixed-point alpha-beta (steady-state Kalman) filter on the raw altitude
+// ADC samples. The yaw rate is measured directly from the yaw edge
+// timestamps, so needs no filter.
+//
+// While flying, the filter also uses the commanded main rotor duty to
+// predict the vertical acceleration, relative to the learned hover duty.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+#include "control.h"
+#include "flightState.h"
+
+#include "estimator.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Filter gains, stored as fractions of ESTIMATOR_GAIN_SCALE. The beta gains
+// are the steady-state values for the given alpha: alpha^2 / (2 - alpha).
+#define ESTIMATOR_GAIN_SCALE        65536
+#define ESTIMATOR_ALPHA_ALTITUDE    3277    // 0.05
+#define ESTIMATOR_BETA_ALTITUDE     84      // 0.00128
+
+// The estimates are stored in fixed-point, as ESTIMATOR_FRAC_SCALE times their
+// values in the units returned, so that small rates still move the estimates
+// when divided by the sample rate.
+#define ESTIMATOR_FRAC_SCALE        256
+
+// Vertical acceleration per percent of main rotor duty above the hover duty,
+// i.e. a duty 10% above the hover duty accelerates the helicopter upwards at
+// 50% of the altitude range per second squared. This is a rough linear model
+// of the rig: an error in it biases the rate estimate only while the duty is
+// away from the hover duty, and the measurement residual then corrects it.
+// Setting it to 0 makes the filter purely kinematic.
+// Units: 0.01% / s^2
+#define ESTIMATOR_ALTITUDE_ACCEL_PER_DUTY   500
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+static uint16_t estimatorSampleRate;
+
+// The estimates are only written from estimatorUpdate (at interrupt level),
+// and each is a single 32-bit word, so they can be read without locking.
+// Units are as below, scaled by ESTIMATOR_FRAC_SCALE.
+static volatile int32_t altitudeEstimate = 0;      // Units: 0.01%
+static volatile int32_t altitudeRateEstimate = 0;  // Units: 0.01% / s
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static void alphaBetaUpdate(volatile int32_t* position,
+                            volatile int32_t* rate,
+                            int32_t acceleration, int32_t measurement,
+                            int32_t alpha, int32_t beta);
+
+
+//*****************************************************************************
+// Initialise the estimator for updates at the given sample rate (in Hz).
+//*****************************************************************************
+void initEstimator(uint16_t sampleRate) {
+    estimatorSampleRate = sampleRate;
+}
+
+//*****************************************************************************
+// Updates the estimates with a new altitude measurement. Should be called at
+// the sample rate, i.e. whenever a new altitude sample has been taken.
+//*****************************************************************************
+void estimatorUpdate(int32_t altitude) {
+    int32_t altitudeAccel = 0;
+
+    // The model only holds while the helicopter is off the ground. While
+    // finding the yaw reference it is still on the ground, and landing
+    // ends in contact with the ground, so the filter is kinematic in those
+    // states.
+    if (getFlightState() == FLYING) {
+        altitudeAccel = ((int32_t) getMainRotorPower() - controlHoverDuty())
+                        * ESTIMATOR_ALTITUDE_ACCEL_PER_DUTY
+                        * ESTIMATOR_FRAC_SCALE;
+    }
+
+    alphaBetaUpdate(&altitudeEstimate, &altitudeRateEstimate, altitudeAccel,
+                    altitude * ESTIMATOR_FRAC_SCALE,
+                    ESTIMATOR_ALPHA_ALTITUDE, ESTIMATOR_BETA_ALTITUDE);
+}
+
+//*****************************************************************************
+// Performs one step of an alpha-beta filter: predicts the position and rate
+// one sample ahead using the given acceleration, then corrects both using
+// the residual between the measurement and the predicted position.
+//*****************************************************************************
+static void alphaBetaUpdate(volatile int32_t* position,
+                            volatile int32_t* rate,
+                            int32_t acceleration, int32_t measurement,
+                            int32_t alpha, int32_t beta) {
+    int32_t predictedPosition = *position + *rate / estimatorSampleRate;
+    int32_t predictedRate = *rate + acceleration / estimatorSampleRate;
+    int32_t residual = measurement - predictedPosition;
+
+    *position = predictedPosition
+                + (int32_t) ((int64_t) alpha * residual / ESTIMATOR_GAIN_SCALE);
+    *rate = predictedRate
+            + (int32_t) ((int64_t) beta * residual * estimatorSampleRate
+                         / ESTIMATOR_GAIN_SCALE);
+}
+
+//*****************************************************************************
+// Returns the estimated vertical rate, positive upwards. Units: 0.01% / s
+//*****************************************************************************
+int32_t estimatorAltitudeRate(void) {
+    return altitudeRateEstimate / ESTIMATOR_FRAC_SCALE;
+}
@@ -0,0 +1,39 @@
+//*****************************************************************************
+//
+// File: estimator.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which estimates the vertical rate of the helicopter, using a
+// fixed-point alpha-beta (steady-state Kalman) filter on the raw altitude
+// ADC samples. The yaw rate is measured directly from the yaw edge
+// timestamps, so needs no filter.
+//
+//*****************************************************************************
+
+#ifndef ESTIMATOR_H_
+#define ESTIMATOR_H_
+
+
+//*****************************************************************************
+// Initialise the estimator for updates at the given sample rate (in Hz).
+//*****************************************************************************
+void initEstimator(uint16_t sampleRate);
+
+//*****************************************************************************
+// Updates the estimates with a new altitude measurement. Should be called at
+// the sample rate, i.e. whenever a new altitude sample has been taken.
+//
+// altitude: The altitude of the new sample. Units: 0.01%
+//*****************************************************************************
+void estimatorUpdate(int32_t altitude);
+
+//*****************************************************************************
+// Returns the estimated vertical rate, positive upwards. Units: 0.01% / s
+//*****************************************************************************
+int32_t estimatorAltitudeRate(void);
+
+
+#endif  // ESTIMATOR_H_
@@ -0,0 +1,346 @@
+//*****************************************************************************
+//
+// File: flightLog.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which keeps a persistent log of flights in the internal EEPROM,
+// so that the last flights are available after a power cycle or crash.
+//
+// Each entry holds a summary of one flight and a decimated trace of its
+// altitude and yaw. Entries are appended in a ring over the whole EEPROM,
+// so each location is written once per lap, spreading the wear evenly.
+// Entries are built in RAM during the flight and only written to the EEPROM
+// from a background task, one word at a time, so the control update never
+// waits for the EEPROM. The words are written in order, ending with a
+// check word holding the complement of the sequence number, so an entry torn
+// by a loss of power reads as empty rather than as the most recent flight,
+// without writing any word twice.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/eeprom.h"
+#include "driverlib/sysctl.h"
+#include "utils/ustdlib.h"
+#include "altitude.h"
+#include "yaw.h"
+#include "rotors.h"
+#include "uartUSB.h"
+
+#include "flightLog.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define EEPROM_SIZE_BYTES       2048
+#define TRACE_LEN               16
+
+// Initial number of control updates between trace samples. Each time the
+// trace fills, every second sample is discarded and the interval is doubled,
+// up to TRACE_MAX_INTERVAL times the initial interval.
+#define TRACE_INITIAL_INTERVAL  200
+#define TRACE_MAX_INTERVAL      128
+
+// Maximum length of the lines sent over UART for one entry: the summary,
+// and the altitude and yaw traces.
+#define SUMMARY_LEN             60
+#define TRACE_LINE_LEN          (26 + TRACE_LEN * 5)
+#define ENTRY_LINES_LEN         (SUMMARY_LEN + 2 * TRACE_LINE_LEN)
+
+
+//*****************************************************************************
+// A log entry, a whole number of 32-bit EEPROM words. The yaw trace is
+// stored in units of 2 degrees to fit in an int8_t.
+//*****************************************************************************
+typedef struct {
+    uint32_t sequence;               // Flight number
+    uint32_t duration;               // Units: control updates
+    uint16_t saturatedTime;          // Units: control updates
+    uint16_t maxAltitudeError;       // Units: %
+    uint16_t maxYawError;            // Units: deg
+    uint8_t numTransitions;          // Number of flight state changes
+    uint8_t traceInterval;           // Units: TRACE_INITIAL_INTERVAL updates
+    int8_t altitudeTrace[TRACE_LEN]; // Units: %
+    int8_t yawTrace[TRACE_LEN];      // Units: 2 deg
+    uint32_t check;                  // ~sequence once fully written
+} flightLogEntry_t;
+
+#define ENTRY_WORDS             (sizeof(flightLogEntry_t) / 4)
+#define NUM_ENTRIES             (EEPROM_SIZE_BYTES / sizeof(flightLogEntry_t))
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+
+// The entry for the current flight, built up during the flight.
+static flightLogEntry_t current;
+static bool flying = false;
+static flightState_t previousState = LANDED;
+static uint8_t traceIndex = 0;
+static uint16_t traceCounter = 0;
+
+// The entry waiting to be written, and the next word to write.
+static flightLogEntry_t staged;
+static volatile bool stagedReady = false;
+static uint8_t stagedWord = 0;
+
+// Location of the next entry to write, and the next sequence number.
+static uint16_t nextEntry = 0;
+static uint32_t nextSequence = 0;
+
+// Entry to send next during the startup dump, or NUM_ENTRIES once done.
+static uint16_t dumpEntry = 0;
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static void flightLogStartFlight(void);
+static bool flightLogReadEntry(uint16_t entry, flightLogEntry_t* stored);
+static void flightLogAddTraceSample(vehicleState_t* state);
+static bool flightLogSendEntry(uint16_t entry);
+static uint16_t flightLogFormatTrace(char* line, uint16_t length,
+                                     uint32_t sequence, char axis,
+                                     uint8_t interval, int8_t* trace,
+                                     int16_t scale);
+
+
+//*****************************************************************************
+// Initialises the EEPROM and finds the most recent entry in the log, so that
+// new entries are appended after it.
+//*****************************************************************************
+void initFlightLog(void) {
+    flightLogEntry_t stored;
+    uint16_t i;
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    EEPROMInit();
+
+    for (i = 0; i < NUM_ENTRIES; i++) {
+        if (flightLogReadEntry(i, &stored)
+                && stored.sequence >= nextSequence) {
+            nextSequence = stored.sequence + 1;
+            nextEntry = (i + 1) % NUM_ENTRIES;
+        }
+    }
+}
+
+//*****************************************************************************
+// Updates the summary and trace of the current flight from the given state.
+// A flight starts when the helicopter starts taking off and ends when it
+// lands, at which point the entry is staged to be written.
+//*****************************************************************************
+void flightLogUpdate(vehicleState_t* state) {
+    if (!flying) {
+        if (state->flightState == FINDING_YAW_REFERENCE) {
+            flightLogStartFlight();
+        } else {
+            return;
+        }
+    }
+
+    if (state->flightState != previousState) {
+        previousState = state->flightState;
+        if (current.numTransitions < UINT8_MAX) {
+            current.numTransitions++;
+        }
+    }
+
+    int16_t altitudeError = altitudeReference() - state->altitude;
+    int16_t yawError = convertYawToRange(yawReference() - state->yaw);
+    if (altitudeError < 0) {
+        altitudeError = -altitudeError;
+    }
+    if (yawError < 0) {
+        yawError = -yawError;
+    }
+    if (altitudeError > current.maxAltitudeError) {
+        current.maxAltitudeError = altitudeError;
+    }
+    if (yawError > current.maxYawError) {
+        current.maxYawError = yawError;
+    }
+
+    if ((state->mainRotorPower >= PWM_MAX_DUTY
+            || state->tailRotorPower >= PWM_MAX_DUTY)
+            && current.saturatedTime < UINT16_MAX) {
+        current.saturatedTime++;
+    }
+
+    current.duration++;
+    flightLogAddTraceSample(state);
+
+    // Stage the entry once landed, unless the previous one is still being
+    // written, in which case this flight is not logged.
+    if (state->flightState == LANDED) {
+        flying = false;
+        if (!stagedReady) {
+            staged = current;
+            stagedWord = 0;
+            stagedReady = true;
+        }
+    }
+}
+
+//*****************************************************************************
+// Clears the entry for the current flight when a new flight starts.
+//*****************************************************************************
+static void flightLogStartFlight(void) {
+    uint8_t i;
+
+    current.sequence = nextSequence++;
+    current.check = ~current.sequence;
+    current.duration = 0;
+    current.saturatedTime = 0;
+    current.maxAltitudeError = 0;
+    current.maxYawError = 0;
+    current.numTransitions = 0;
+    current.traceInterval = 1;
+    for (i = 0; i < TRACE_LEN; i++) {
+        current.altitudeTrace[i] = 0;
+        current.yawTrace[i] = 0;
+    }
+
+    traceIndex = 0;
+    traceCounter = 0;
+    previousState = FINDING_YAW_REFERENCE;
+    flying = true;
+}
+
+//*****************************************************************************
+// Adds a sample to the trace at the current trace interval. When the trace
+// is full, every second sample is discarded and the interval is doubled, so
+// the trace always covers the whole flight.
+//*****************************************************************************
+static void flightLogAddTraceSample(vehicleState_t* state) {
+    uint8_t i;
+
+    if (traceCounter > 0) {
+        traceCounter--;
+        return;
+    }
+
+    if (traceIndex >= TRACE_LEN) {
+        if (current.traceInterval >= TRACE_MAX_INTERVAL) {
+            return;
+        }
+        for (i = 0; i < TRACE_LEN / 2; i++) {
+            current.altitudeTrace[i] = current.altitudeTrace[2 * i];
+            current.yawTrace[i] = current.yawTrace[2 * i];
+        }
+        traceIndex = TRACE_LEN / 2;
+        current.traceInterval *= 2;
+    }
+
+    current.altitudeTrace[traceIndex] = state->altitude;
+    current.yawTrace[traceIndex] = state->yaw / 2;
+    traceIndex++;
+    traceCounter = current.traceInterval * TRACE_INITIAL_INTERVAL - 1;
+}
+
+//*****************************************************************************
+// Background task which sends the stored entries over UART once after
+// startup, one entry per call, and then writes the entry for each completed
+// flight to the EEPROM, one word per call.
+//*****************************************************************************
+void flightLogTask(void) {
+    if (dumpEntry < NUM_ENTRIES) {
+        // The entry is sent again at the next call if the UART is busy.
+        if (flightLogSendEntry(dumpEntry)) {
+            dumpEntry++;
+        }
+        return;
+    }
+
+    if (!stagedReady) {
+        return;
+    }
+
+    // The check word is the last word of the entry, so the entry only reads
+    // as valid once every other word has been written.
+    uint32_t* words = (uint32_t*) &staged;
+    uint32_t address = nextEntry * sizeof(flightLogEntry_t);
+    EEPROMProgram(&words[stagedWord], address + stagedWord * 4,
+                  sizeof(uint32_t));
+    stagedWord++;
+
+    if (stagedWord >= ENTRY_WORDS) {
+        nextEntry = (nextEntry + 1) % NUM_ENTRIES;
+        stagedReady = false;
+    }
+}
+
+//*****************************************************************************
+// Reads the given stored entry from the EEPROM.
+//
+// returns: false if the entry is empty (erased) or was not fully written.
+//*****************************************************************************
+static bool flightLogReadEntry(uint16_t entry, flightLogEntry_t* stored) {
+    EEPROMRead((uint32_t*) stored, entry * sizeof(flightLogEntry_t),
+               sizeof(flightLogEntry_t));
+    return stored->check == ~stored->sequence;
+}
+
+//*****************************************************************************
+// Sends the given stored entry over UART, if it is valid: a summary
+// line ("LOG,sequence,duration,saturated,maxAltError,maxYawError,
+// transitions"), followed by a line for each of the altitude and yaw traces
+// ("LOGT,sequence,A|Y,interval,samples..."). The trace interval is in
+// control updates, the altitude trace in % and the yaw trace in degrees.
+// Unused trace samples are zero.
+//
+// returns: false if the UART was too busy for the entry to be sent.
+//*****************************************************************************
+static bool flightLogSendEntry(uint16_t entry) {
+    flightLogEntry_t stored;
+    char lines[ENTRY_LINES_LEN + 1];
+
+    if (!flightLogReadEntry(entry, &stored)) {
+        return true;
+    }
+
+    // All three lines are sent together, so that they are never separated.
+    uint16_t length = usnprintf(lines, SUMMARY_LEN + 1,
+                                "LOG,%u,%u,%u,%u,%u,%u\r\n",
+                                stored.sequence, stored.duration,
+                                stored.saturatedTime,
+                                stored.maxAltitudeError, stored.maxYawError,
+                                stored.numTransitions);
+    length += flightLogFormatTrace(&lines[length], sizeof(lines) - length,
+                                   stored.sequence, 'A',
+                                   stored.traceInterval,
+                                   stored.altitudeTrace, 1);
+    flightLogFormatTrace(&lines[length], sizeof(lines) - length,
+                         stored.sequence, 'Y', stored.traceInterval,
+                         stored.yawTrace, 2);
+    return uartSendIfRoom(lines);
+}
+
+//*****************************************************************************
+// Formats one trace of a stored entry as a line of CSV, multiplying each
+// sample by the given scale.
+//
+// returns: The number of characters written, excluding the terminator.
+//*****************************************************************************
+static uint16_t flightLogFormatTrace(char* line, uint16_t length,
+                                     uint32_t sequence, char axis,
+                                     uint8_t interval, int8_t* trace,
+                                     int16_t scale) {
+    uint16_t i;
+    uint16_t written = usnprintf(line, length, "LOGT,%u,%c,%u", sequence,
+                                 axis, interval * TRACE_INITIAL_INTERVAL);
+    for (i = 0; i < TRACE_LEN && written < length; i++) {
+        written += usnprintf(&line[written], length - written, ",%d",
+                             trace[i] * scale);
+    }
+    if (written < length) {
+        written += usnprintf(&line[written], length - written, "\r\n");
+    }
+    return written < length ? written : length - 1;
+}
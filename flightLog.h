@@ -0,0 +1,46 @@
+//*****************************************************************************
+//
+// File: flightLog.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which keeps a persistent log of flights in the internal EEPROM,
+// so that the last flights are available after a power cycle or crash.
+//
+// Each entry holds a summary of one flight and a decimated trace of its
+// altitude and yaw. Entries are appended in a ring over the whole EEPROM,
+// so each location is written once per lap, spreading the wear evenly.
+// Entries are built in RAM during the flight and only written to the EEPROM
+// from a background task, one word at a time, so the control update never
+// waits for the EEPROM.
+//
+//*****************************************************************************
+
+#ifndef FLIGHT_LOG_H_
+#define FLIGHT_LOG_H_
+
+#include "vehicleState.h"
+
+
+//*****************************************************************************
+// Initialises the EEPROM and finds the most recent entry in the log.
+//*****************************************************************************
+void initFlightLog(void);
+
+//*****************************************************************************
+// Updates the summary and trace of the current flight from the given state.
+// Should be called once per control update.
+//*****************************************************************************
+void flightLogUpdate(vehicleState_t* state);
+
+//*****************************************************************************
+// Background task which sends the stored entries over UART once after
+// startup, and then writes the entry for each completed flight to the
+// EEPROM, one word per call.
+//*****************************************************************************
+void flightLogTask(void);
+
+
+#endif  // FLIGHT_LOG_H_
@@ -0,0 +1,190 @@
+//*****************************************************************************
+//
+// File: flightRecorder.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which records the state of the controller at the control rate into
+// a ring buffer in RAM during each flight, and dumps the recording over UART
+// as CSV once the flight has ended.
+//
+// Recording starts when the helicopter starts taking off, and is frozen when
+// it lands or when a fault occurs. A flight which starts before the previous
+// recording (or input capture) has been dumped is not recorded, so that the
+// previous recording is never lost part-way through its dump. Each dumped
+// line starts with "REC," so that it can be separated from the status
+// messages.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
+#include "uartUSB.h"
+#include "inputCapture.h"
+
+#include "flightRecorder.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Number of records in the ring buffer. At 200 Hz this holds the last 2.5 s
+// of each flight, in 9 kB of RAM.
+#define FLIGHT_RECORDER_SIZE    512
+
+// Maximum length of a line of CSV.
+#define LINE_LEN                80
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+static flightRecord_t records[FLIGHT_RECORDER_SIZE];
+
+// Index of the next record to be written, and whether the buffer has
+// wrapped around since recording started.
+static uint16_t recordIndex = 0;
+static bool recordsWrapped = false;
+
+static volatile bool recording = false;
+static volatile bool frozen = false;
+
+// The flight state at the last update, to find when takeoff starts.
+static flightState_t lastState = LANDED;
+
+// Number of records remaining to be dumped, and the index of the next one.
+// The header is sent when dumpRemaining is first set.
+static uint16_t dumpRemaining = 0;
+static uint16_t dumpIndex = 0;
+static bool dumpStarted = false;
+
+
+//*****************************************************************************
+// Checks the flight state, starting a new recording when the helicopter
+// starts taking off (unless the last one is still being dumped) and freezing
+// the recording when it lands. Should be called once per control update,
+// before flightRecorderNext.
+//*****************************************************************************
+void flightRecorderUpdate(flightState_t state) {
+    bool takeoffStarted = state == FINDING_YAW_REFERENCE
+                          && lastState != FINDING_YAW_REFERENCE;
+    lastState = state;
+
+    if (takeoffStarted && !recording && !frozen
+            && !inputCaptureDumpPending()) {
+        recordIndex = 0;
+        recordsWrapped = false;
+        frozen = false;
+        dumpStarted = false;
+        recording = true;
+        inputCaptureStart();
+    } else if (recording && state == LANDED) {
+        flightRecorderFreeze();
+    }
+}
+
+//*****************************************************************************
+// Returns a pointer to the next record to be filled in, advancing the ring
+// buffer, or NULL if not currently recording.
+//*****************************************************************************
+flightRecord_t* flightRecorderNext(void) {
+    if (!recording) {
+        return NULL;
+    }
+
+    flightRecord_t* record = &records[recordIndex];
+    recordIndex++;
+    if (recordIndex >= FLIGHT_RECORDER_SIZE) {
+        recordIndex = 0;
+        recordsWrapped = true;
+    }
+    return record;
+}
+
+//*****************************************************************************
+// Freezes the recording, e.g. when a fault occurs, so that it can be dumped.
+// May be called from background tasks, as well as from the control update.
+//*****************************************************************************
+void flightRecorderFreeze(void) {
+    // The control update must not see the recording half frozen.
+    bool interruptsDisabled = IntMasterDisable();
+    if (recording) {
+        recording = false;
+        frozen = true;
+        inputCaptureFreeze();
+    }
+    if (!interruptsDisabled) {
+        IntMasterEnable();
+    }
+}
+
+//*****************************************************************************
+// Saturates a value to the range of a PID term in a flight record.
+//*****************************************************************************
+int8_t flightRecorderTerm(int32_t value) {
+    if (value > INT8_MAX) {
+        return INT8_MAX;
+    } else if (value < INT8_MIN) {
+        return INT8_MIN;
+    }
+    return value;
+}
+
+//*****************************************************************************
+// Sends the next record of a frozen recording over UART as a line of CSV,
+// preceded by a header line. Should be called regularly as a background
+// task, and does nothing if there is no recording to dump. Never blocks:
+// if the UART is busy, the record is sent at a later call.
+//*****************************************************************************
+void flightRecorderDump(void) {
+    char line[LINE_LEN + 1];
+
+    if (!frozen) {
+        return;
+    }
+
+    if (!dumpStarted) {
+        if (uartSendIfRoom("REC,t,adc,yaw,dAlt,dYaw,aP,aI,aD,yP,yI,yD,"
+                           "main,tail,state\r\n")) {
+            dumpStarted = true;
+            dumpRemaining = recordsWrapped ? FLIGHT_RECORDER_SIZE
+                                           : recordIndex;
+            dumpIndex = recordsWrapped ? recordIndex : 0;
+        }
+        return;
+    }
+
+    if (dumpRemaining == 0) {
+        // The buffer may now be reused by the next flight.
+        dumpStarted = false;
+        frozen = false;
+        return;
+    }
+
+    flightRecord_t* record = &records[dumpIndex];
+    usnprintf(line, sizeof(line),
+              "REC,%u,%u,%d,%u,%d,%d,%d,%d,%d,%d,%d,%u,%u,%u\r\n",
+              record->timestamp, record->meanADC, record->yawCount,
+              record->desiredAltitude, record->desiredYaw,
+              record->altitudeTerms[0], record->altitudeTerms[1],
+              record->altitudeTerms[2], record->yawTerms[0],
+              record->yawTerms[1], record->yawTerms[2],
+              record->mainRotorPower, record->tailRotorPower,
+              record->flightState);
+    if (!uartSendIfRoom(line)) {
+        // Try again at the next call, once the link has caught up.
+        return;
+    }
+
+    dumpIndex++;
+    if (dumpIndex >= FLIGHT_RECORDER_SIZE) {
+        dumpIndex = 0;
+    }
+    dumpRemaining--;
+}
@@ -0,0 +1,77 @@
+//*****************************************************************************
+//
+// File: flightRecorder.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which records the state of the controller at the control rate into
+// a ring buffer in RAM during each flight, and dumps the recording over UART
+// as CSV once the flight has ended.
+//
+// Recording starts when the helicopter starts taking off, and is frozen when
+// it lands or when a fault occurs. Each dumped line starts with "REC," so
+// that it can be separated from the status messages.
+//
+//*****************************************************************************
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include "flightState.h"
+
+
+//*****************************************************************************
+// A single fixed-size record. PID terms are the contributions to the rotor
+// duty cycles in percent, saturated to the range of an int8_t.
+//*****************************************************************************
+typedef struct {
+    uint16_t timestamp;        // Units: control periods (wraps)
+    uint16_t meanADC;          // Raw mean ADC value
+    int16_t yawCount;          // Raw quadrature count (wraps)
+    int16_t desiredYaw;        // Units: deg
+    uint8_t desiredAltitude;   // Units: %
+    uint8_t mainRotorPower;    // Units: %
+    uint8_t tailRotorPower;    // Units: %
+    uint8_t flightState;
+    int8_t altitudeTerms[3];   // Proportional, integral, derivative
+    int8_t yawTerms[3];        // Proportional, integral, derivative
+} flightRecord_t;
+
+
+//*****************************************************************************
+// Checks the flight state, starting a new recording when the helicopter
+// starts taking off (unless the last one is still being dumped) and freezing
+// the recording when it lands. Should be called once per control update,
+// before flightRecorderNext.
+//*****************************************************************************
+void flightRecorderUpdate(flightState_t state);
+
+//*****************************************************************************
+// Returns a pointer to the next record to be filled in, advancing the ring
+// buffer, or NULL if not currently recording.
+//*****************************************************************************
+flightRecord_t* flightRecorderNext(void);
+
+//*****************************************************************************
+// Freezes the recording, e.g. when a fault occurs, so that it can be dumped.
+// May be called from background tasks, as well as from the control update.
+//*****************************************************************************
+void flightRecorderFreeze(void);
+
+//*****************************************************************************
+// Saturates a value to the range of a PID term in a flight record.
+//*****************************************************************************
+int8_t flightRecorderTerm(int32_t value);
+
+//*****************************************************************************
+// Sends the next record of a frozen recording over UART as a line of CSV,
+// preceded by a header line. Should be called regularly as a background
+// task, and does nothing if there is no recording to dump. Never blocks:
+// if the UART is busy, the record is sent at a later call.
+//*****************************************************************************
+void flightRecorderDump(void);
+
+
+#endif  // FLIGHT_RECORDER_H_
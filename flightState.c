@@ -7,17 +7,157 @@
 //          James Brazier (jbr185)
 //
 // Defines the states which the helicopter can be in during its flight, and
-// declares a global state variable to allow the state to be accessed and
-// modified from multiple files.
+// the state machine which moves between them. Transitions are defined in a
+// table, and are taken either when an event is posted (e.g. by the switch
+// or the yaw reference interrupt) or when a guard condition becomes true.
+// Each state can have entry, exit and periodic actions. Transitions are
+// evaluated at the control rate, and each one is timestamped and logged.
 //
 //*****************************************************************************
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
+#include "altitude.h"
+#include "yaw.h"
+#include "rotors.h"
+#include "uartUSB.h"
+#include "health.h"
+
 #include "flightState.h"
 
 
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Number of transitions kept in the log. Must be a power of two.
+#define TRANSITION_LOG_SIZE     16
+
+// Maximum length of a line sent over UART.
+#define LINE_LEN                80
+
+
+//*****************************************************************************
+// The actions of a state, any of which may be NULL. The entry and exit
+// actions are run when the state is entered or left, and the periodic
+// action at each update while in the state.
+//*****************************************************************************
+typedef struct {
+    const char* name;
+    char* displayName;
+    void (*entry)(void);
+    void (*exit)(void);
+    void (*periodic)(void);
+} stateActions_t;
+
+//*****************************************************************************
+// A transition from one state to another. Taken when the event has been
+// posted (or always, for FLIGHT_EVENT_NONE) and the guard returns true (or
+// always, if the guard is NULL).
+//*****************************************************************************
+typedef struct {
+    flightState_t from;
+    flightEvent_t event;
+    bool (*guard)(void);
+    flightState_t to;
+} transition_t;
+
+//*****************************************************************************
+// A logged transition.
+//*****************************************************************************
+typedef struct {
+    uint32_t time;              // Units: ms since startup
+    uint8_t from;
+    uint8_t to;
+    uint8_t event;
+} transitionRecord_t;
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static void startTakeoff(void);
+static void stopRotors(void);
+static void changeState(flightState_t newState, flightEvent_t event);
+static uint32_t updatesToMs(uint32_t updates);
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+
+static const stateActions_t states[NUM_FLIGHT_STATES] = {
+    // name, display name, entry, exit, periodic
+    {"LANDED", "Landed", stopRotors, NULL, NULL},
+    {"FINDING_YAW_REFERENCE", "Taking off", startTakeoff, NULL,
+     yawUpdateSearch},
+    {"FLYING", "Flying", yawReconcileReference, NULL, NULL},
+    {"LANDING_YAW", "Landing", yawStartLanding, NULL, NULL},
+    {"LANDING_ALTITUDE", "Landing", altitudeStartLanding, NULL,
+     altitudeUpdateLanding}
+};
+
+static const transition_t transitions[] = {
+    // from, event, guard, to
+    // Faults are checked first, so that they take priority over any other
+    // event posted in the same update. A fault requiring a landing skips
+    // restoring the yaw, as the yaw may be the cause of the fault.
+    {FINDING_YAW_REFERENCE, FLIGHT_EVENT_FAULT_STOP, NULL, LANDED},
+    {FLYING, FLIGHT_EVENT_FAULT_STOP, NULL, LANDED},
+    {LANDING_YAW, FLIGHT_EVENT_FAULT_STOP, NULL, LANDED},
+    {LANDING_ALTITUDE, FLIGHT_EVENT_FAULT_STOP, NULL, LANDED},
+    {FINDING_YAW_REFERENCE, FLIGHT_EVENT_FAULT_LAND, NULL, LANDING_ALTITUDE},
+    {FLYING, FLIGHT_EVENT_FAULT_LAND, NULL, LANDING_ALTITUDE},
+    {LANDING_YAW, FLIGHT_EVENT_FAULT_LAND, NULL, LANDING_ALTITUDE},
+
+    {LANDED, FLIGHT_EVENT_SWITCH_UP, healthTakeoffAllowed,
+     FINDING_YAW_REFERENCE},
+    {FINDING_YAW_REFERENCE, FLIGHT_EVENT_YAW_REFERENCE, NULL, FLYING},
+    {FLYING, FLIGHT_EVENT_SWITCH_DOWN, NULL, LANDING_YAW},
+    {LANDING_YAW, FLIGHT_EVENT_NONE, yawLandingComplete, LANDING_ALTITUDE},
+    {LANDING_ALTITUDE, FLIGHT_EVENT_NONE, altitudeLandingComplete, LANDED}
+};
+
+#define NUM_TRANSITIONS     (sizeof(transitions) / sizeof(transitions[0]))
+
+static const char* const eventNames[NUM_FLIGHT_EVENTS] = {
+    "NONE", "SWITCH_UP", "SWITCH_DOWN", "YAW_REFERENCE", "FAULT_LAND",
+    "FAULT_STOP"
+};
+
 // The current state of the helicopter.
-static flightState_t flightState;
+static volatile flightState_t flightState;
+
+// Events posted since the last update, one bit per event.
+static volatile uint32_t pendingEvents = 0;
 
+// Number of updates since startup, and at which the current state was
+// entered, and the total number of updates spent in each state before the
+// current one. Converted to time using the update rate.
+static uint32_t numUpdates = 0;
+static uint32_t stateEnteredUpdate = 0;
+static uint32_t stateUpdates[NUM_FLIGHT_STATES];
+static uint16_t flightStateUpdateRate = 1;
+
+// Ring buffer of the most recent transitions, with the total number logged
+// and the number sent over UART.
+static transitionRecord_t transitionLog[TRANSITION_LOG_SIZE];
+static volatile uint32_t numLogged = 0;
+static uint32_t numDumped = 0;
+
+
+//*****************************************************************************
+// Sets the initial state, running its entry action.
+//*****************************************************************************
+void initFlightState(flightState_t state) {
+    flightState = state;
+    if (states[state].entry != NULL) {
+        states[state].entry();
+    }
+}
 
 //*****************************************************************************
 // Returns the current state of the helicopter.
@@ -27,22 +167,168 @@ flightState_t getFlightState(void) {
 }
 
 //*****************************************************************************
-// Sets the current state to the given value.
+// Posts an event to the state machine, to be handled at the next update.
+// Events which do not cause a transition from the current state are
+// discarded. May be called from interrupt handlers.
 //*****************************************************************************
-void setFlightState(flightState_t state) {
-    flightState = state;
+void flightStatePostEvent(flightEvent_t event) {
+    bool interruptsDisabled = IntMasterDisable();
+    pendingEvents |= 1u << event;
+    if (!interruptsDisabled) {
+        IntMasterEnable();
+    }
 }
 
 //*****************************************************************************
-// Returns the current state as a string to be displayed.
+// Takes the first transition from the current state whose event has been
+// posted and whose guard holds, then runs the periodic action of the
+// (possibly new) state. Should be called at the given update rate (in Hz).
 //*****************************************************************************
-char* flightStateString(void) {
-    switch (flightState) {
-        case LANDED: return "Landed";
-        case FINDING_YAW_REFERENCE: return "Taking off";
-        case FLYING: return "Flying";
-        case LANDING_YAW: return "Landing";
-        case LANDING_ALTITUDE: return "Landing";
-        default: return "";
+void flightStateUpdate(uint16_t updateRate) {
+    flightStateUpdateRate = updateRate;
+    numUpdates++;
+
+    // Take all events posted so far, so that none are lost between
+    // checking and clearing them.
+    bool interruptsDisabled = IntMasterDisable();
+    uint32_t events = pendingEvents | (1u << FLIGHT_EVENT_NONE);
+    pendingEvents = 0;
+    if (!interruptsDisabled) {
+        IntMasterEnable();
     }
+
+    uint16_t i = 0;
+    for (i = 0; i < NUM_TRANSITIONS; i++) {
+        const transition_t* transition = &transitions[i];
+        if (transition->from == flightState
+                && (events & (1u << transition->event))
+                && (transition->guard == NULL || transition->guard())) {
+            changeState(transition->to, transition->event);
+            break;
+        }
+    }
+
+    if (states[flightState].periodic != NULL) {
+        states[flightState].periodic();
+    }
+}
+
+//*****************************************************************************
+// Runs the exit action of the current state and the entry action of the new
+// state, updating the time spent in each and logging the transition.
+//*****************************************************************************
+static void changeState(flightState_t newState, flightEvent_t event) {
+    if (states[flightState].exit != NULL) {
+        states[flightState].exit();
+    }
+
+    transitionRecord_t* record =
+            &transitionLog[numLogged & (TRANSITION_LOG_SIZE - 1)];
+    record->time = updatesToMs(numUpdates);
+    record->from = flightState;
+    record->to = newState;
+    record->event = event;
+    numLogged++;
+
+    stateUpdates[flightState] += numUpdates - stateEnteredUpdate;
+    stateEnteredUpdate = numUpdates;
+    flightState = newState;
+
+    if (states[newState].entry != NULL) {
+        states[newState].entry();
+    }
+}
+
+//*****************************************************************************
+// Returns the time spent in the current state, in milliseconds.
+//*****************************************************************************
+uint32_t flightStateTimeInState(void) {
+    return updatesToMs(numUpdates - stateEnteredUpdate);
+}
+
+//*****************************************************************************
+// Returns the total time spent in the given state since startup, in
+// milliseconds.
+//*****************************************************************************
+uint32_t flightStateTotalTime(flightState_t state) {
+    uint32_t updates = stateUpdates[state];
+    if (state == flightState) {
+        updates += numUpdates - stateEnteredUpdate;
+    }
+    return updatesToMs(updates);
+}
+
+//*****************************************************************************
+// Returns the given state as a string to be displayed.
+//*****************************************************************************
+char* flightStateString(flightState_t state) {
+    if (state >= NUM_FLIGHT_STATES) {
+        return "";
+    }
+    return states[state].displayName;
+}
+
+//*****************************************************************************
+// Sends any transitions which have not yet been sent over UART, one per
+// call, as "FSM," lines. Should be called regularly as a background task.
+//*****************************************************************************
+void flightStateDump(void) {
+    char line[LINE_LEN + 1];
+    transitionRecord_t record;
+    uint32_t totalTime;
+
+    // Transitions are logged from the control interrupt, so the entry is
+    // copied with interrupts disabled, so that it cannot be overwritten
+    // part way through.
+    bool interruptsDisabled = IntMasterDisable();
+
+    if (numDumped == numLogged) {
+        if (!interruptsDisabled) {
+            IntMasterEnable();
+        }
+        return;
+    }
+
+    // Skip any transitions which have been overwritten.
+    if (numLogged - numDumped > TRANSITION_LOG_SIZE) {
+        numDumped = numLogged - TRANSITION_LOG_SIZE;
+    }
+
+    record = transitionLog[numDumped & (TRANSITION_LOG_SIZE - 1)];
+    totalTime = flightStateTotalTime((flightState_t) record.from);
+    numDumped++;
+
+    if (!interruptsDisabled) {
+        IntMasterEnable();
+    }
+
+    usnprintf(line, sizeof(line), "FSM,%u,%s,%s,%s,%u\r\n", record.time,
+              states[record.from].name, states[record.to].name,
+              eventNames[record.event], totalTime);
+    uartSend(line);
+}
+
+//*****************************************************************************
+// Entry action for taking off: starts both rotors and climbs to a safe
+// hover while the yaw reference is found.
+//*****************************************************************************
+static void startTakeoff(void) {
+    startMainRotor();
+    startTailRotor();
+    altitudeStartTakeoff();
+}
+
+//*****************************************************************************
+// Entry action for landing: stops both rotors.
+//*****************************************************************************
+static void stopRotors(void) {
+    stopMainRotor();
+    stopTailRotor();
+}
+
+//*****************************************************************************
+// Converts a number of updates to milliseconds, at the update rate.
+//*****************************************************************************
+static uint32_t updatesToMs(uint32_t updates) {
+    return (uint64_t) updates * 1000 / flightStateUpdateRate;
 }
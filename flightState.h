@@ -7,8 +7,11 @@
 //          James Brazier (jbr185)
 //
 // Defines the states which the helicopter can be in during its flight, and
-// declares a global state variable to allow the state to be accessed and
-// modified from multiple files.
+// the state machine which moves between them. Transitions are defined in a
+// table, and are taken either when an event is posted (e.g. by the switch
+// or the yaw reference interrupt) or when a guard condition becomes true.
+// Each state can have entry, exit and periodic actions. Transitions are
+// evaluated at the control rate, and each one is timestamped and logged.
 //
 //*****************************************************************************
 
@@ -18,13 +21,30 @@
 
 // A type representing the possible states of the helicopter.
 enum flightStates {LANDED = 0,             // Stationary with rotors off
-                   FINDING_YAW_REFERENCE,  // Rotating in steps to find reference
+                   FINDING_YAW_REFERENCE,  // Rotating to find reference
                    FLYING,
                    LANDING_YAW,       // Restoring the yaw to zero for landing
-                   LANDING_ALTITUDE}; // Restoring the altitude to zero for landing
+                   LANDING_ALTITUDE,  // Restoring the altitude to zero for landing
+                   NUM_FLIGHT_STATES};
 
 typedef enum flightStates flightState_t;
 
+// Events which can cause a change of state.
+enum flightEvents {FLIGHT_EVENT_NONE = 0,
+                   FLIGHT_EVENT_SWITCH_UP,
+                   FLIGHT_EVENT_SWITCH_DOWN,
+                   FLIGHT_EVENT_YAW_REFERENCE,
+                   FLIGHT_EVENT_FAULT_LAND,   // Fault requiring a landing
+                   FLIGHT_EVENT_FAULT_STOP,   // Fault requiring rotors off
+                   NUM_FLIGHT_EVENTS};
+
+typedef enum flightEvents flightEvent_t;
+
+
+//*****************************************************************************
+// Sets the initial state, running its entry action.
+//*****************************************************************************
+void initFlightState(flightState_t state);
 
 //*****************************************************************************
 // Returns the current state of the helicopter.
@@ -32,14 +52,40 @@ typedef enum flightStates flightState_t;
 flightState_t getFlightState(void);
 
 //*****************************************************************************
-// Sets the current state to the given value.
+// Posts an event to the state machine, to be handled at the next update.
+// Events which do not cause a transition from the current state are
+// discarded. May be called from interrupt handlers.
+//*****************************************************************************
+void flightStatePostEvent(flightEvent_t event);
+
+//*****************************************************************************
+// Takes the first transition from the current state whose event has been
+// posted and whose guard holds, then runs the periodic action of the
+// (possibly new) state. Should be called at the given update rate (in Hz).
+//*****************************************************************************
+void flightStateUpdate(uint16_t updateRate);
+
+//*****************************************************************************
+// Returns the time spent in the current state, in milliseconds.
+//*****************************************************************************
+uint32_t flightStateTimeInState(void);
+
+//*****************************************************************************
+// Returns the total time spent in the given state since startup, in
+// milliseconds.
+//*****************************************************************************
+uint32_t flightStateTotalTime(flightState_t state);
+
+//*****************************************************************************
+// Returns the given state as a string to be displayed.
 //*****************************************************************************
-void setFlightState(flightState_t state);
+char* flightStateString(flightState_t state);
 
 //*****************************************************************************
-// Returns the current state as a string to be displayed.
+// Sends any transitions which have not yet been sent over UART, one per
+// call, as "FSM," lines. Should be called regularly as a background task.
 //*****************************************************************************
-char* flightStateString(void);
+void flightStateDump(void);
 
 
 #endif  // FLIGHT_STATE_H_
@@ -0,0 +1,298 @@
+//*****************************************************************************
+//
+// File: health.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which monitors the health of the helicopter while the rotors are
+// running, and escalates faults to a controlled landing or stopping the
+// rotors. Each check has a threshold, and a time for which its condition
+// must hold before the fault is raised. Also kicks the hardware watchdog,
+// but only while the control loop is running on time and every critical
+// background task has run within its deadline.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverlib/interrupt.h"
+#include "vehicleState.h"
+#include "flightState.h"
+#include "control.h"
+#include "rotors.h"
+#include "watchdog.h"
+#include "scheduler.h"
+#include "flightRecorder.h"
+
+#include "health.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// The watchdog timeout. Must be longer than the longest time any background
+// task can block the scheduler for, e.g. while sending over UART.
+#define WATCHDOG_TIMEOUT_MS     500
+
+// The maximum raw ADC value.
+#define ADC_MAX                 4095
+
+
+//*****************************************************************************
+// A check, with its configuration and the number of consecutive checks for
+// which its condition has held.
+//*****************************************************************************
+typedef struct {
+    bool (*condition)(vehicleState_t* state, int32_t threshold);
+    int32_t threshold;
+    uint16_t timeMs;
+    faultAction_t action;
+    uint32_t updates;
+} check_t;
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static bool adcOutOfRange(vehicleState_t* state, int32_t threshold);
+static bool tailNoYaw(vehicleState_t* state, int32_t threshold);
+static bool integratorPegged(vehicleState_t* state, int32_t threshold);
+static bool controlOverrun(vehicleState_t* state, int32_t threshold);
+static bool referenceTimeout(vehicleState_t* state, int32_t threshold);
+static void raiseFault(fault_t fault);
+static void kickWatchdog(void);
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+
+static check_t checks[NUM_FAULTS] = {
+    [FAULT_ADC_RANGE] = {.condition = adcOutOfRange, .threshold = 50,
+                         .timeMs = 100, .action = FAULT_ACTION_STOP},
+    [FAULT_TAIL_NO_YAW] = {.condition = tailNoYaw,
+                           .threshold = PWM_MAX_DUTY,
+                           .timeMs = 2000, .action = FAULT_ACTION_LAND},
+    [FAULT_INTEGRATOR_PEGGED] = {.condition = integratorPegged,
+                                 .threshold = 0, .timeMs = 5000,
+                                 .action = FAULT_ACTION_LAND},
+    [FAULT_CONTROL_OVERRUN] = {.condition = controlOverrun, .threshold = 0,
+                               .timeMs = 0, .action = FAULT_ACTION_NONE},
+    [FAULT_REFERENCE_TIMEOUT] = {.condition = referenceTimeout,
+                                 .threshold = 15000, .timeMs = 0,
+                                 .action = FAULT_ACTION_LAND}
+};
+
+static uint16_t healthCheckRate = 1;
+static uint16_t controlUpdateRate = 1;
+
+static uint16_t faultCounts[NUM_FAULTS];
+static uint16_t activeFaults = 0;
+
+// Whether a fault has stopped the rotors, preventing another takeoff.
+static bool rotorsStopped = false;
+
+// Values at the previous check, to find what has changed since.
+static int32_t lastYawCount = 0;
+static uint32_t lastOverrunCount = 0;
+static uint16_t lastUpdateCount = 0;
+
+
+//*****************************************************************************
+// Initialises the health monitor, which should be run as a task at the
+// given rate (in Hz), and starts the watchdog. The control update rate (in
+// Hz) is used to check that the control loop is running on time.
+//*****************************************************************************
+void initHealth(uint16_t checkRate, uint16_t controlRate) {
+    healthCheckRate = checkRate;
+    controlUpdateRate = controlRate;
+    lastOverrunCount = controlOverrunCount();
+    lastUpdateCount = controlUpdateCount();
+
+    initWatchdog(WATCHDOG_TIMEOUT_MS);
+}
+
+//*****************************************************************************
+// Configures a check. The threshold is in the units of the check:
+//  FAULT_ADC_RANGE:          distance of the mean ADC value from either rail
+//  FAULT_TAIL_NO_YAW:        tail rotor power (%) at or above which the yaw
+//                            is expected to move
+//  FAULT_INTEGRATOR_PEGGED:  unused
+//  FAULT_CONTROL_OVERRUN:    overruns allowed per check
+//  FAULT_REFERENCE_TIMEOUT:  time (ms) allowed to find the yaw reference
+// The fault is raised once the condition has held for the given time (ms).
+//*****************************************************************************
+void healthSetCheck(fault_t fault, int32_t threshold, uint16_t timeMs,
+                    faultAction_t action) {
+    checks[fault].threshold = threshold;
+    checks[fault].timeMs = timeMs;
+    checks[fault].action = action;
+    checks[fault].updates = 0;
+}
+
+//*****************************************************************************
+// Background task which runs each check, raising faults and taking their
+// actions, and kicks the watchdog if the control loop and the critical
+// background tasks are running on time.
+//*****************************************************************************
+void healthUpdate(void) {
+    vehicleState_t state;
+    vehicleStateGet(&state);
+
+    uint16_t i = 0;
+    for (i = 0; i < NUM_FAULTS; i++) {
+        check_t* check = &checks[i];
+        bool condition = check->condition(&state, check->threshold);
+
+        // Nothing is checked while the rotors are off, but each condition
+        // is still evaluated so that it tracks what has changed.
+        if (state.flightState == LANDED || !condition) {
+            check->updates = 0;
+            activeFaults &= ~(1u << i);
+            continue;
+        }
+
+        if (activeFaults & (1u << i)) {
+            continue;
+        }
+
+        check->updates++;
+        if (check->updates * 1000
+                >= (uint32_t) check->timeMs * healthCheckRate) {
+            raiseFault((fault_t) i);
+        }
+    }
+
+    kickWatchdog();
+}
+
+//*****************************************************************************
+// Records the given fault as active and takes its action. Faults which end
+// the flight also freeze the flight recording, so that the moment of the
+// fault is not overwritten while landing.
+//*****************************************************************************
+static void raiseFault(fault_t fault) {
+    activeFaults |= 1u << fault;
+    faultCounts[fault]++;
+
+    if (checks[fault].action != FAULT_ACTION_NONE) {
+        flightRecorderFreeze();
+    }
+
+    switch (checks[fault].action) {
+    case FAULT_ACTION_LAND:
+        flightStatePostEvent(FLIGHT_EVENT_FAULT_LAND);
+        break;
+    case FAULT_ACTION_STOP: {
+        // Stop the rotors now rather than waiting for the state machine,
+        // which will enter LANDED at the next control update. The state
+        // machine's entry actions start and stop the rotors from the
+        // control interrupt, so interrupts are disabled until the stop
+        // event is posted, and no takeoff can start in between.
+        bool interruptsDisabled = IntMasterDisable();
+        stopMainRotor();
+        stopTailRotor();
+        rotorsStopped = true;
+        flightStatePostEvent(FLIGHT_EVENT_FAULT_STOP);
+        if (!interruptsDisabled) {
+            IntMasterEnable();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+//*****************************************************************************
+// Kicks the watchdog if the control loop is running on time, with at least
+// half of the expected control updates run since the last check and none of
+// them overrunning, and every critical task has run within its deadline.
+//*****************************************************************************
+static void kickWatchdog(void) {
+    uint16_t updateCount = controlUpdateCount();
+    uint16_t updates = updateCount - lastUpdateCount;
+    uint32_t overrunCount = controlOverrunCount();
+
+    if (updates * 2 * healthCheckRate >= controlUpdateRate
+            && overrunCount == lastOverrunCount
+            && schedulerCriticalTasksAlive()) {
+        watchdogKick();
+    }
+
+    lastUpdateCount = updateCount;
+    lastOverrunCount = overrunCount;
+}
+
+//*****************************************************************************
+// The mean ADC value is within the threshold of either rail, suggesting the
+// altitude sensor is disconnected or shorted.
+//*****************************************************************************
+static bool adcOutOfRange(vehicleState_t* state, int32_t threshold) {
+    return state->meanADC < threshold || state->meanADC > ADC_MAX - threshold;
+}
+
+//*****************************************************************************
+// The tail rotor power is at or above the threshold, but no yaw edges have
+// been seen since the last check.
+//*****************************************************************************
+static bool tailNoYaw(vehicleState_t* state, int32_t threshold) {
+    bool stuck = state->tailRotorPower >= threshold
+                 && state->yawCount == lastYawCount;
+    lastYawCount = state->yawCount;
+    return stuck;
+}
+
+//*****************************************************************************
+// While flying, the altitude or yaw output is held at one of its limits, so
+// its integrator is not accumulating. Not checked while taking off or
+// landing, when the main rotor is expected to sit at its minimum duty.
+//*****************************************************************************
+static bool integratorPegged(vehicleState_t* state, int32_t threshold) {
+    (void) threshold;
+    return state->flightState == FLYING
+           && (controlAltitudeSaturated() || controlYawSaturated());
+}
+
+//*****************************************************************************
+// More than the threshold number of control updates have overrun since the
+// last check.
+//*****************************************************************************
+static bool controlOverrun(vehicleState_t* state, int32_t threshold) {
+    (void) state;
+    return controlOverrunCount() - lastOverrunCount > (uint32_t) threshold;
+}
+
+//*****************************************************************************
+// The yaw reference has been searched for longer than the threshold (ms).
+//*****************************************************************************
+static bool referenceTimeout(vehicleState_t* state, int32_t threshold) {
+    return state->flightState == FINDING_YAW_REFERENCE
+           && flightStateTimeInState() > (uint32_t) threshold;
+}
+
+//*****************************************************************************
+// Returns the number of times the given fault has been raised.
+//*****************************************************************************
+uint16_t healthFaultCount(fault_t fault) {
+    return faultCounts[fault];
+}
+
+//*****************************************************************************
+// Returns the currently active faults, one bit per fault.
+//*****************************************************************************
+uint16_t healthActiveFaults(void) {
+    return activeFaults;
+}
+
+//*****************************************************************************
+// Returns whether taking off is allowed, which it is not once a fault has
+// stopped the rotors.
+//*****************************************************************************
+bool healthTakeoffAllowed(void) {
+    return !rotorsStopped;
+}
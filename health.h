@@ -0,0 +1,84 @@
+//*****************************************************************************
+//
+// File: health.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which monitors the health of the helicopter while the rotors are
+// running, and escalates faults to a controlled landing or stopping the
+// rotors. Each check has a threshold, and a time for which its condition
+// must hold before the fault is raised. Also kicks the hardware watchdog,
+// but only while the control loop is running on time and every critical
+// background task has run within its deadline.
+//
+//*****************************************************************************
+
+#ifndef HEALTH_H_
+#define HEALTH_H_
+
+
+// The faults which are checked for.
+enum faults {FAULT_ADC_RANGE = 0,      // Mean ADC value near either rail
+             FAULT_TAIL_NO_YAW,        // Tail rotor high but yaw not moving
+             FAULT_INTEGRATOR_PEGGED,  // Control output held at a limit
+             FAULT_CONTROL_OVERRUN,    // Control update overran its period
+             FAULT_REFERENCE_TIMEOUT,  // Yaw reference not found in time
+             NUM_FAULTS};
+
+typedef enum faults fault_t;
+
+// The action taken when a fault is raised.
+enum faultActions {FAULT_ACTION_NONE = 0,  // Only count the fault
+                   FAULT_ACTION_LAND,      // Land without restoring the yaw
+                   FAULT_ACTION_STOP};     // Stop the rotors immediately
+
+typedef enum faultActions faultAction_t;
+
+
+//*****************************************************************************
+// Initialises the health monitor, which should be run as a task at the
+// given rate (in Hz), and starts the watchdog. The control update rate (in
+// Hz) is used to check that the control loop is running on time.
+//*****************************************************************************
+void initHealth(uint16_t checkRate, uint16_t controlRate);
+
+//*****************************************************************************
+// Configures a check. The threshold is in the units of the check:
+//  FAULT_ADC_RANGE:          distance of the mean ADC value from either rail
+//  FAULT_TAIL_NO_YAW:        tail rotor power (%) at or above which the yaw
+//                            is expected to move
+//  FAULT_INTEGRATOR_PEGGED:  unused
+//  FAULT_CONTROL_OVERRUN:    overruns allowed per check
+//  FAULT_REFERENCE_TIMEOUT:  time (ms) allowed to find the yaw reference
+// The fault is raised once the condition has held for the given time (ms).
+//*****************************************************************************
+void healthSetCheck(fault_t fault, int32_t threshold, uint16_t timeMs,
+                    faultAction_t action);
+
+//*****************************************************************************
+// Background task which runs each check, raising faults and taking their
+// actions, and kicks the watchdog if the control loop and the critical
+// background tasks are running on time.
+//*****************************************************************************
+void healthUpdate(void);
+
+//*****************************************************************************
+// Returns the number of times the given fault has been raised.
+//*****************************************************************************
+uint16_t healthFaultCount(fault_t fault);
+
+//*****************************************************************************
+// Returns the currently active faults, one bit per fault.
+//*****************************************************************************
+uint16_t healthActiveFaults(void);
+
+//*****************************************************************************
+// Returns whether taking off is allowed, which it is not once a fault has
+// stopped the rotors.
+//*****************************************************************************
+bool healthTakeoffAllowed(void);
+
+
+#endif  // HEALTH_H_
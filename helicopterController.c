@@ -12,7 +12,6 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "driverlib/sysctl.h"
 #include "driverlib/systick.h"
 #include "driverlib/interrupt.h"
 #include "buttons4.h"
@@ -25,44 +24,93 @@
 #include "scheduler.h"
 #include "rotors.h"
 #include "control.h"
+#include "estimator.h"
+#include "flightRecorder.h"
+#include "flightLog.h"
+#include "inputCapture.h"
+#include "benchmark.h"
+#include "wcet.h"
+#include "clock.h"
 #include "flightState.h"
+#include "health.h"
+#include "watchdog.h"
 
 
 //*****************************************************************************
 // Constants
 //*****************************************************************************
 #define ALTITUDE_SAMPLE_RATE_HZ            400
-#define CONTROL_UPDATE_RATE_HZ             20
 #define BUTTON_CHECK_RATE_HZ               10
 #define SWITCH_CHECK_RATE_HZ               10
 #define DISPLAY_UPDATE_RATE_HZ             5
 #define UART_SEND_RATE_HZ                  4
-#define UPDATE_TAKEOFF_LANDING_RATE_HZ     2
+#define UART_COMMAND_RATE_HZ               10
+#define FLIGHT_RECORDER_DUMP_RATE_HZ       20
+#define FLIGHT_STATE_DUMP_RATE_HZ          10
+#define FLIGHT_LOG_RATE_HZ                 20
+#define INPUT_CAPTURE_DUMP_RATE_HZ         20
+#define BENCHMARK_REPORT_RATE_HZ           2
+#define WCET_REPORT_RATE_HZ                2
+#define HEALTH_CHECK_RATE_HZ               50
+
+// Critical tasks must have run within this time for the watchdog to be
+// kicked. Longer than the longest time a task can block the scheduler for.
+#define CRITICAL_TASK_DEADLINE_MS          400
+#define CRITICAL_TASK_DEADLINE_TICKS \
+        (SYSTICK_RATE_HZ * CRITICAL_TASK_DEADLINE_MS / 1000)
 
 // Altitude sampling is the highest frequency task, so use this as SysTick rate.
 #define SYSTICK_RATE_HZ          ALTITUDE_SAMPLE_RATE_HZ
 
-// The amount by which altitude and yaw change when the buttons are pushed.
+// The SysTick counter is 24 bits wide.
+#if CLOCK_RATE_HZ / SYSTICK_RATE_HZ > 0x1000000
+#error "SysTick period does not fit in the SysTick counter"
+#endif
+
+// The control loop runs from its own timer interrupt, independent of SysTick.
+#define CONTROL_UPDATE_RATE_HZ   200
+
+// Worst-case rates of the yaw interrupts, used for the schedulability
+// analysis. Assumes the helicopter spins at no more than 2 revolutions per
+// second, giving 448 quadrature edges and one reference pulse per revolution.
+#define YAW_EDGE_RATE_MAX_HZ         (448 * 2)
+#define YAW_REFERENCE_RATE_MAX_HZ    2
+
+// The button and switch interrupts are masked for the debounce interval
+// after each edge, so each of the four ports (three for the buttons, one for
+// the switch) can cause at most one edge interrupt per interval, and each
+// of the two debounce timers one interrupt. The button hold timer runs
+// once per hold tick while a button is held.
+#define INPUT_EDGE_RATE_MAX_HZ       (4 * 1000 / BUT_DEBOUNCE_MS)
+#define INPUT_DEBOUNCE_RATE_MAX_HZ   (2 * 1000 / BUT_DEBOUNCE_MS)
+#define BUTTON_HOLD_RATE_MAX_HZ      (1000 / BUT_HOLD_TICK_MS)
+
+// The UART interrupt runs at most once per character received and once
+// per character sent, and each character takes 10 bit times at 9600 baud.
+#define UART_RATE_MAX_HZ             (2 * 9600 / 10)
+
+// The amount by which altitude and yaw change when the buttons are pushed,
+// and at each auto-repeat while they are held. At the default repeat
+// interval, holding UP or DOWN ramps the altitude at its rate limit.
 #define ALTITUDE_STEP_PERCENT    10
 #define YAW_STEP_DEGREES         15
+#define ALTITUDE_RAMP_PERCENT    2
+#define YAW_RAMP_DEGREES         5
 
 
 //*****************************************************************************
 // The interrupt handler for the for SysTick interrupt.
 //*****************************************************************************
 void SysTickIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_SYSTICK);
+    BENCHMARK_START(BENCH_SYSTICK);
     altitudeTriggerConversion();
-    updateButtons();
-    updateSwitch1();
-    schedulerUpdateTicks();
-}
 
-//*****************************************************************************
-// Initialise the clock, setting the rate to 20MHz
-//*****************************************************************************
-void initClock(void) {
-    SysCtlClockSet(SYSCTL_SYSDIV_10 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
-                   SYSCTL_XTAL_16MHZ);
+    BENCHMARK_START(BENCH_SCHEDULER_TICKS);
+    schedulerUpdateTicks();
+    BENCHMARK_STOP(BENCH_SCHEDULER_TICKS);
+    BENCHMARK_STOP(BENCH_SYSTICK);
+    WCET_ISR_EXIT(WCET_ISR_SYSTICK);
 }
 
 //*****************************************************************************
@@ -71,7 +119,7 @@ void initClock(void) {
 //*****************************************************************************
 void initSysTick(void) {
     // Set up the period for the SysTick timer.
-    SysTickPeriodSet(SysCtlClockGet() / SYSTICK_RATE_HZ);
+    SysTickPeriodSet(clockRate() / SYSTICK_RATE_HZ);
 
     // Register the interrupt handler.
     SysTickIntRegister(SysTickIntHandler);
@@ -82,95 +130,147 @@ void initSysTick(void) {
 }
 
 //*****************************************************************************
-// Checks if any of the buttons have been pushed, and updates the desired
-// altitude and yaw as needed.
-// Note: buttons are updated regularly in the SysTickIntHandler.
+// Updates the desired altitude and yaw for one button event. A press steps
+// the setpoint, and holding a button ramps it. Pressing LEFT and RIGHT
+// together turns back to the yaw reference.
 //*****************************************************************************
-void checkButtons(void) {
-    // The altitude and yaw should only be changed if the helicopter is flying.
-    if (getFlightState() == FLYING) {
-        if (checkButton(RIGHT) == PUSHED) {
+void handleButtonEvent(const buttonEvent_t* event) {
+    switch (event->type) {
+    case BUT_EVENT_PRESS:
+        if (event->buttons == BUT_MASK(RIGHT)) {
             yawChangeDesired(YAW_STEP_DEGREES);
-        }
-
-        if (checkButton(LEFT) == PUSHED) {
+        } else if (event->buttons == BUT_MASK(LEFT)) {
             yawChangeDesired(-YAW_STEP_DEGREES);
-        }
-
-        if (checkButton(UP) == PUSHED) {
+        } else if (event->buttons == BUT_MASK(UP)) {
             altitudeChangeDesired(ALTITUDE_STEP_PERCENT);
-        }
-
-        if (checkButton(DOWN) == PUSHED) {
+        } else if (event->buttons == BUT_MASK(DOWN)) {
             altitudeChangeDesired(-ALTITUDE_STEP_PERCENT);
         }
+        break;
+    case BUT_EVENT_HOLD:
+    case BUT_EVENT_REPEAT:
+        if (event->buttons == BUT_MASK(RIGHT)) {
+            yawChangeDesired(YAW_RAMP_DEGREES);
+        } else if (event->buttons == BUT_MASK(LEFT)) {
+            yawChangeDesired(-YAW_RAMP_DEGREES);
+        } else if (event->buttons == BUT_MASK(UP)) {
+            altitudeChangeDesired(ALTITUDE_RAMP_PERCENT);
+        } else if (event->buttons == BUT_MASK(DOWN)) {
+            altitudeChangeDesired(-ALTITUDE_RAMP_PERCENT);
+        }
+        break;
+    case BUT_EVENT_CHORD:
+        if (event->buttons == (BUT_MASK(LEFT) | BUT_MASK(RIGHT))) {
+            yawChangeDesired(-yawDesired());
+        }
+        break;
+    default:
+        break;
     }
 }
 
 //*****************************************************************************
-// Checks the state of the switch and performs the appropriate actions to
-// change the state of the helicopter.
+// Handles all the button events queued since the last call, updating the
+// desired altitude and yaw as needed.
+// Note: button events are queued from the button interrupts.
 //*****************************************************************************
-void checkSwitch(void) {
-    switchState_t switchState = checkSwitch1();
-
-    if (switchState == SWITCH_UP && getFlightState() == LANDED) {
-        startMainRotor();
-        startTailRotor();
-        setFlightState(FINDING_YAW_REFERENCE);
+void checkButtons(void) {
+    buttonEvent_t event;
 
-    } else if (switchState == SWITCH_DOWN && getFlightState() == FLYING) {
-        setFlightState(LANDING_YAW);
+    while (buttonsGetEvent(&event)) {
+        // The altitude and yaw should only be changed if the helicopter is
+        // flying. The flight state machine runs in the control interrupt,
+        // and the landing states set their own targets on entry, so the
+        // state is checked and the targets changed with interrupts disabled.
+        bool interruptsDisabled = IntMasterDisable();
+        if (getFlightState() == FLYING) {
+            handleButtonEvent(&event);
+        }
+        if (!interruptsDisabled) {
+            IntMasterEnable();
+        }
     }
 }
 
 //*****************************************************************************
-// If the helicopter is currently taking off (finding the reference yaw signal)
-// or landing, updates the desired yaw or altitude, or changes the flight
-// state of the helicopter as necessary.
+// Checks the state of the switch, and notifies the flight state machine if
+// it has been moved.
 //*****************************************************************************
-void updateTakeOffOrLanding(void) {
-    if (getFlightState() == FINDING_YAW_REFERENCE) {
-        yawChangeDesired(YAW_STEP_DEGREES);
-    } else if (getFlightState() == LANDING_YAW) {
-        yawUpdateLanding(YAW_STEP_DEGREES);
-    } else if (getFlightState() == LANDING_ALTITUDE) {
-        altitudeUpdateLanding(ALTITUDE_STEP_PERCENT);
+void checkSwitch(void) {
+    switchState_t switchState = checkSwitch1();
+
+    if (switchState == SWITCH_UP) {
+        flightStatePostEvent(FLIGHT_EVENT_SWITCH_UP);
+    } else if (switchState == SWITCH_DOWN) {
+        flightStatePostEvent(FLIGHT_EVENT_SWITCH_DOWN);
     }
 }
 
 int main(void) {
+    // Make sure the rotors are off before anything else is initialised.
+    rotorsForceOff();
+
     // Disable interrupts during initialisation.
     IntMasterDisable();
 
+    watchdogCheckReset();
+
     initClock();
+    initBenchmark();
+    initWcet(SYSTICK_RATE_HZ);
+    wcetSetIsrRate(WCET_ISR_SYSTICK, SYSTICK_RATE_HZ);
+    wcetSetIsrRate(WCET_ISR_ADC, ALTITUDE_SAMPLE_RATE_HZ);
+    wcetSetIsrRate(WCET_ISR_YAW_EDGE, YAW_EDGE_RATE_MAX_HZ);
+    wcetSetIsrRate(WCET_ISR_YAW_REFERENCE, YAW_REFERENCE_RATE_MAX_HZ);
+    wcetSetIsrRate(WCET_ISR_CONTROL, CONTROL_UPDATE_RATE_HZ);
+    wcetSetIsrRate(WCET_ISR_INPUT_EDGE, INPUT_EDGE_RATE_MAX_HZ);
+    wcetSetIsrRate(WCET_ISR_INPUT_DEBOUNCE, INPUT_DEBOUNCE_RATE_MAX_HZ);
+    wcetSetIsrRate(WCET_ISR_BUTTON_HOLD, BUTTON_HOLD_RATE_MAX_HZ);
+    wcetSetIsrRate(WCET_ISR_UART, UART_RATE_MAX_HZ);
     initSysTick();
     initUart();
+    watchdogReportReset();
     initButtons();
     initSwitch();
     initDisplay();
+    initEstimator(ALTITUDE_SAMPLE_RATE_HZ);
     initAltitude();
     initYaw();
     initRotors();
     initControl(CONTROL_UPDATE_RATE_HZ);
+    initFlightLog();
 
-    setFlightState(LANDED);
+    initFlightState(LANDED);
 
     // Initialise the scheduler and register the background tasks with it.
     // Tasks are registered in order of priority, with highest first.
-    initScheduler(6);
-    schedulerRegisterTask(controlUpdate,
-                          SYSTICK_RATE_HZ / CONTROL_UPDATE_RATE_HZ);
+    initScheduler(12);
+    schedulerRegisterCriticalTask(healthUpdate,
+                                  SYSTICK_RATE_HZ / HEALTH_CHECK_RATE_HZ,
+                                  CRITICAL_TASK_DEADLINE_TICKS);
     schedulerRegisterTask(checkButtons,
                           SYSTICK_RATE_HZ / BUTTON_CHECK_RATE_HZ);
-    schedulerRegisterTask(checkSwitch,
-                          SYSTICK_RATE_HZ / SWITCH_CHECK_RATE_HZ);
-    schedulerRegisterTask(updateTakeOffOrLanding,
-                          SYSTICK_RATE_HZ / UPDATE_TAKEOFF_LANDING_RATE_HZ);
+    schedulerRegisterCriticalTask(checkSwitch,
+                                  SYSTICK_RATE_HZ / SWITCH_CHECK_RATE_HZ,
+                                  CRITICAL_TASK_DEADLINE_TICKS);
     schedulerRegisterTask(displayUpdate,
                           SYSTICK_RATE_HZ / DISPLAY_UPDATE_RATE_HZ);
+    schedulerRegisterTask(uartCheckCommands,
+                          SYSTICK_RATE_HZ / UART_COMMAND_RATE_HZ);
     schedulerRegisterTask(uartSendStatus,
                           SYSTICK_RATE_HZ / UART_SEND_RATE_HZ);
+    schedulerRegisterTask(flightRecorderDump,
+                          SYSTICK_RATE_HZ / FLIGHT_RECORDER_DUMP_RATE_HZ);
+    schedulerRegisterTask(flightStateDump,
+                          SYSTICK_RATE_HZ / FLIGHT_STATE_DUMP_RATE_HZ);
+    schedulerRegisterTask(flightLogTask,
+                          SYSTICK_RATE_HZ / FLIGHT_LOG_RATE_HZ);
+    schedulerRegisterTask(inputCaptureDump,
+                          SYSTICK_RATE_HZ / INPUT_CAPTURE_DUMP_RATE_HZ);
+    schedulerRegisterTask(benchmarkReport,
+                          SYSTICK_RATE_HZ / BENCHMARK_REPORT_RATE_HZ);
+    schedulerRegisterTask(wcetReport,
+                          SYSTICK_RATE_HZ / WCET_REPORT_RATE_HZ);
 
     // Enable interrupts to the processor once initialisation is complete.
     IntMasterEnable();
@@ -179,6 +279,13 @@ int main(void) {
     // initialisation is complete (and interrupts are enabled).
     altitudeSetReference();
 
+    // Start the control loop now that the altitude reference is valid.
+    controlStart();
+
+    // Start monitoring for faults, and the watchdog, now that the control
+    // loop is running.
+    initHealth(HEALTH_CHECK_RATE_HZ, CONTROL_UPDATE_RATE_HZ);
+
     // Start running the background tasks.
     schedulerStart();
 }
@@ -0,0 +1,202 @@
+//*****************************************************************************
+//
+// File: inputCapture.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which captures the raw sensor inputs (ADC samples, yaw channel and
+// reference edges, and button and switch pin changes) with timestamps into a
+// ring buffer in RAM, so that they can be dumped over UART after a flight
+// and replayed through the same processing functions used by the interrupt
+// handlers (altitudeProcessSample, yawProcessChannels, yawProcessReference,
+// updateButtonsFromValues and updateSwitch1FromPosition).
+//
+// Capture runs alongside the flight recorder, so the buffer holds the inputs
+// leading up to a landing or fault.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/ustdlib.h"
+#include "yaw.h"
+#include "uartUSB.h"
+
+#include "inputCapture.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Number of inputs in the ring buffer. At the 400 Hz ADC sample rate plus
+// yaw edges, this holds roughly the last second of inputs, in 4 kB of RAM.
+#define INPUT_CAPTURE_SIZE      512
+
+// Maximum length of a line of CSV.
+#define LINE_LEN                40
+
+
+//*****************************************************************************
+// A captured input, timestamped with the free-running yaw timer.
+//*****************************************************************************
+typedef struct {
+    uint32_t timestamp;    // Units: system clock ticks (wraps)
+    uint16_t value;
+    uint8_t type;
+} capturedInput_t;
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+static capturedInput_t inputs[INPUT_CAPTURE_SIZE];
+
+// Index of the next input to be written, and whether the buffer has
+// wrapped around since the capture started.
+static uint16_t inputIndex = 0;
+static bool inputsWrapped = false;
+
+static volatile bool capturing = false;
+static volatile bool frozen = false;
+
+// The last value recorded for each type, for inputCaptureRecordChange.
+static uint16_t lastValues[NUM_CAPTURE_TYPES];
+
+// Number of inputs remaining to be dumped, and the index of the next one.
+static uint16_t dumpRemaining = 0;
+static uint16_t dumpIndex = 0;
+static bool dumpStarted = false;
+
+
+//*****************************************************************************
+// Starts a new capture, discarding any previous one.
+//*****************************************************************************
+void inputCaptureStart(void) {
+    uint8_t i;
+
+    capturing = false;
+    inputIndex = 0;
+    inputsWrapped = false;
+    frozen = false;
+    dumpStarted = false;
+    for (i = 0; i < NUM_CAPTURE_TYPES; i++) {
+        lastValues[i] = UINT16_MAX;
+    }
+    capturing = true;
+}
+
+//*****************************************************************************
+// Returns whether a frozen capture has not yet been completely dumped.
+//*****************************************************************************
+bool inputCaptureDumpPending(void) {
+    return frozen;
+}
+
+//*****************************************************************************
+// Freezes the capture so that it can be dumped.
+//*****************************************************************************
+void inputCaptureFreeze(void) {
+    if (capturing) {
+        capturing = false;
+        frozen = true;
+    }
+}
+
+//*****************************************************************************
+// Records an input with the current timestamp, if capturing.
+// The interrupts recording inputs all have the same priority, so they
+// cannot preempt each other while writing to the buffer.
+//*****************************************************************************
+void inputCaptureRecord(captureType_t type, uint16_t value) {
+    inputCaptureRecordAt(type, value, yawTimestamp());
+}
+
+//*****************************************************************************
+// Records an input with the given timestamp, if capturing. Used for inputs
+// which are timestamped by their interrupt handler, so that the replayed
+// timestamp is exactly the one used originally.
+//*****************************************************************************
+void inputCaptureRecordAt(captureType_t type, uint16_t value,
+                          uint32_t timestamp) {
+    if (!capturing) {
+        return;
+    }
+
+    capturedInput_t* input = &inputs[inputIndex];
+    input->timestamp = timestamp;
+    input->value = value;
+    input->type = type;
+    lastValues[type] = value;
+
+    inputIndex++;
+    if (inputIndex >= INPUT_CAPTURE_SIZE) {
+        inputIndex = 0;
+        inputsWrapped = true;
+    }
+}
+
+//*****************************************************************************
+// Records an input with the current timestamp only if its value differs from
+// the last value recorded for that type.
+//*****************************************************************************
+void inputCaptureRecordChange(captureType_t type, uint16_t value) {
+    inputCaptureRecordChangeAt(type, value, yawTimestamp());
+}
+
+//*****************************************************************************
+// Records an input with the given timestamp only if its value differs from
+// the last value recorded for that type. Used for the buttons and switch,
+// which are timestamped at their first edge but read after debouncing.
+//*****************************************************************************
+void inputCaptureRecordChangeAt(captureType_t type, uint16_t value,
+                                uint32_t timestamp) {
+    if (value != lastValues[type]) {
+        inputCaptureRecordAt(type, value, timestamp);
+    }
+}
+
+//*****************************************************************************
+// Sends the next captured input of a frozen capture over UART as a line of
+// CSV ("CAP,time,type,value"). Should be called regularly as a background
+// task, and does nothing if there is no capture to dump. Never blocks: if
+// the UART is busy, the input is sent at a later call.
+//*****************************************************************************
+void inputCaptureDump(void) {
+    char line[LINE_LEN + 1];
+
+    if (!frozen) {
+        return;
+    }
+
+    if (!dumpStarted) {
+        if (uartSendIfRoom("CAP,time,type,value\r\n")) {
+            dumpStarted = true;
+            dumpRemaining = inputsWrapped ? INPUT_CAPTURE_SIZE : inputIndex;
+            dumpIndex = inputsWrapped ? inputIndex : 0;
+        }
+        return;
+    }
+
+    if (dumpRemaining == 0) {
+        dumpStarted = false;
+        frozen = false;
+        return;
+    }
+
+    capturedInput_t* input = &inputs[dumpIndex];
+    usnprintf(line, sizeof(line), "CAP,%u,%u,%u\r\n",
+              input->timestamp, input->type, input->value);
+    if (!uartSendIfRoom(line)) {
+        // Try again at the next call, once the link has caught up.
+        return;
+    }
+
+    dumpIndex++;
+    if (dumpIndex >= INPUT_CAPTURE_SIZE) {
+        dumpIndex = 0;
+    }
+    dumpRemaining--;
+}
@@ -0,0 +1,88 @@
+//*****************************************************************************
+//
+// File: inputCapture.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which captures the raw sensor inputs (ADC samples, yaw channel and
+// reference edges, and button and switch pin changes) with timestamps into a
+// ring buffer in RAM, so that they can be dumped over UART after a flight
+// and replayed through the same processing functions used by the interrupt
+// handlers (altitudeProcessSample, yawProcessChannels, yawProcessReference,
+// updateButtonsFromValues and updateSwitch1FromPosition).
+//
+// Capture runs alongside the flight recorder, so the buffer holds the inputs
+// leading up to a landing or fault.
+//
+//*****************************************************************************
+
+#ifndef INPUT_CAPTURE_H_
+#define INPUT_CAPTURE_H_
+
+
+// Types of captured input.
+enum captureTypes {CAPTURE_ADC = 0,        // Value: raw ADC sample
+                   CAPTURE_YAW,            // Value: bit 0 channel A, bit 1 B
+                   CAPTURE_YAW_REFERENCE,  // Value: unused
+                   CAPTURE_BUTTONS,        // Value: bit n is button n HIGH
+                   CAPTURE_SWITCH,         // Value: switch position
+                   NUM_CAPTURE_TYPES};
+
+typedef enum captureTypes captureType_t;
+
+
+//*****************************************************************************
+// Starts a new capture, discarding any previous one.
+//*****************************************************************************
+void inputCaptureStart(void);
+
+//*****************************************************************************
+// Returns whether a frozen capture has not yet been completely dumped.
+//*****************************************************************************
+bool inputCaptureDumpPending(void);
+
+//*****************************************************************************
+// Freezes the capture so that it can be dumped.
+//*****************************************************************************
+void inputCaptureFreeze(void);
+
+//*****************************************************************************
+// Records an input with the current timestamp, if capturing.
+//*****************************************************************************
+void inputCaptureRecord(captureType_t type, uint16_t value);
+
+//*****************************************************************************
+// Records an input with the given timestamp, if capturing. Used for inputs
+// which are timestamped by their interrupt handler, so that the replayed
+// timestamp is exactly the one used originally.
+//*****************************************************************************
+void inputCaptureRecordAt(captureType_t type, uint16_t value,
+                          uint32_t timestamp);
+
+//*****************************************************************************
+// Records an input with the current timestamp only if its value differs from
+// the last value recorded for that type. Used for inputs which rarely
+// change, such as the buttons and switch.
+//*****************************************************************************
+void inputCaptureRecordChange(captureType_t type, uint16_t value);
+
+//*****************************************************************************
+// Records an input with the given timestamp only if its value differs from
+// the last value recorded for that type. Used for the buttons and switch,
+// which are timestamped at their first edge but read after debouncing.
+//*****************************************************************************
+void inputCaptureRecordChangeAt(captureType_t type, uint16_t value,
+                                uint32_t timestamp);
+
+//*****************************************************************************
+// Sends the next captured input of a frozen capture over UART as a line of
+// CSV ("CAP,time,type,value"). Should be called regularly as a background
+// task, and does nothing if there is no capture to dump. Never blocks: if
+// the UART is busy, the input is sent at a later call.
+//*****************************************************************************
+void inputCaptureDump(void);
+
+
+#endif  // INPUT_CAPTURE_H_
@@ -18,6 +18,10 @@
 #include "driverlib/gpio.h"
 #include "driverlib/pwm.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/interrupt.h"
+#include "clock.h"
+#include "benchmark.h"
+#include "board.h"
 
 #include "rotors.h"
 
@@ -25,152 +29,343 @@
 //*****************************************************************************
 // Constants
 //*****************************************************************************
+
+// The PWM clock divider is chosen so that the PWM period fits in the
+// 16-bit generator counter, which counts to period / 2 in up/down mode.
+#if CLOCK_RATE_HZ > 40000000
+#define PWM_DIVIDER_CODE           SYSCTL_PWMDIV_8
+#define PWM_DIVIDER                8
+#else
 #define PWM_DIVIDER_CODE           SYSCTL_PWMDIV_4
 #define PWM_DIVIDER                4
-
-// Main rotor.
-#define PWM_MAIN_ROTOR_FREQUENCY   250
-#define PWM_MAIN_ROTOR_BASE        PWM0_BASE
-#define PWM_MAIN_ROTOR_GEN         PWM_GEN_3
-#define PWM_MAIN_ROTOR_OUTNUM      PWM_OUT_7
-#define PWM_MAIN_ROTOR_OUTBIT      PWM_OUT_7_BIT
-#define PWM_MAIN_ROTOR_PERIPH_PWM  SYSCTL_PERIPH_PWM0
-#define PWM_MAIN_ROTOR_PERIPH_GPIO SYSCTL_PERIPH_GPIOC
-#define PWM_MAIN_ROTOR_GPIO_BASE   GPIO_PORTC_BASE
-#define PWM_MAIN_ROTOR_GPIO_CONFIG GPIO_PC5_M0PWM7
-#define PWM_MAIN_ROTOR_GPIO_PIN    GPIO_PIN_5
-
-// Tail rotor.
-#define PWM_TAIL_ROTOR_FREQUENCY   250
-#define PWM_TAIL_ROTOR_BASE        PWM1_BASE
-#define PWM_TAIL_ROTOR_GEN         PWM_GEN_2
-#define PWM_TAIL_ROTOR_OUTNUM      PWM_OUT_5
-#define PWM_TAIL_ROTOR_OUTBIT      PWM_OUT_5_BIT
-#define PWM_TAIL_ROTOR_PERIPH_PWM  SYSCTL_PERIPH_PWM1
-#define PWM_TAIL_ROTOR_PERIPH_GPIO SYSCTL_PERIPH_GPIOF
-#define PWM_TAIL_ROTOR_GPIO_BASE   GPIO_PORTF_BASE
-#define PWM_TAIL_ROTOR_GPIO_CONFIG GPIO_PF1_M1PWM5
-#define PWM_TAIL_ROTOR_GPIO_PIN    GPIO_PIN_1
+#endif
+#define PWM_CLOCK_HZ               (CLOCK_RATE_HZ / PWM_DIVIDER)
+#define PWM_MAX_PERIOD             (2 * 0xFFFF)
+
+// The shortest allowed period, which still gives a distinct pulse width for
+// each unit of duty cycle.
+#define PWM_MIN_PERIOD             (100 * PWM_DUTY_SCALE)
+
+// Initial largest change in duty cycle per control update, in
+// PWM_DUTY_SCALE units, to limit the current drawn on large steps.
+#define PWM_MAIN_SLEW_LIMIT        30
+#define PWM_TAIL_SLEW_LIMIT        30
+
+// Pulse widths are calculated by multiplying the duty cycle by a
+// precomputed width per unit of duty, which is scaled by 2^PWM_WIDTH_SHIFT
+// to keep its fractional part. The product fits in 32 bits for periods up
+// to PWM_MAX_PERIOD.
+#define PWM_WIDTH_SHIFT            14
+
+// New periods and pulse widths are only latched at the end of a PWM period,
+// after a global synchronisation is requested by rotorsUpdate, so that both
+// rotors change together and never part-way through a period.
+#define PWM_GEN_MODE               (PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_SYNC \
+                                    | PWM_GEN_MODE_GEN_SYNC_GLOBAL)
+
+// Initial PWM frequency of both rotors. May be overridden in the build
+// configuration, and changed at run time with setRotorFrequency. Both
+// rotors always share one frequency, so that their periods end together
+// and updates to both are latched at the same period boundary.
+#ifndef PWM_ROTOR_FREQUENCY
+#define PWM_ROTOR_FREQUENCY        250
+#endif
+
+// Check that the PWM frequency can be generated exactly from the clock.
+#if PWM_CLOCK_HZ % PWM_ROTOR_FREQUENCY != 0
+#error "Rotor PWM frequency is not an exact division of the PWM clock"
+#endif
+#if PWM_CLOCK_HZ / PWM_ROTOR_FREQUENCY > PWM_MAX_PERIOD
+#error "Rotor PWM period does not fit in the PWM generator counter"
+#endif
+#if PWM_CLOCK_HZ / PWM_ROTOR_FREQUENCY < PWM_MIN_PERIOD
+#error "Rotor PWM period is too short for the duty cycle resolution"
+#endif
 
 
 //*****************************************************************************
 // Static variables
 //*****************************************************************************
 
-// Current duty cycle of the two motors.
-static uint16_t mainRotorPower = 0;
-static uint16_t tailRotorPower = 0;
+// The PWM outputs and pins driving the rotors.
+static const boardRotor_t rotors[BOARD_NUM_ROTORS] = BOARD_ROTORS;
+static const boardRotor_t* const mainRotor = &rotors[BOARD_MAIN_ROTOR];
+static const boardRotor_t* const tailRotor = &rotors[BOARD_TAIL_ROTOR];
+
+// Current duty cycle of the two motors, in PWM_DUTY_SCALE units.
+static uint16_t mainRotorDuty = 0;
+static uint16_t tailRotorDuty = 0;
+
+// PWM period of both motors in PWM clock ticks, and the pulse width per
+// unit of duty cycle, calculated when the frequency is set.
+static uint32_t pulsePeriod;
+static uint32_t widthPerDuty;
+
+// Pulse width last written to the PWM generator of each motor.
+static uint32_t mainPulseWidth = 0;
+static uint32_t tailPulseWidth = 0;
+
+// Largest change in duty cycle of each motor per call to set its duty
+// cycle (i.e. per control update), in PWM_DUTY_SCALE units. Zero for no
+// limit.
+static uint16_t mainSlewLimit = PWM_MAIN_SLEW_LIMIT;
+static uint16_t tailSlewLimit = PWM_TAIL_SLEW_LIMIT;
+
+#ifdef BENCHMARK_ENABLED
+// Time at which the last update was requested, and whether it is still
+// waiting to be latched at the end of the main rotor's PWM period.
+static volatile uint32_t updateRequestTime;
+static volatile bool updatePending = false;
+#endif
 
 
 //*****************************************************************************
 // Static function forward declarations
 //*****************************************************************************
-static void initialiseMainRotor();
-static void initialiseTailRotor();
+static void initialiseRotor(const boardRotor_t* rotor);
 static uint32_t calculatePulsePeriod(uint32_t frequency);
-static uint32_t calculatePulseWidth(uint32_t dutyCycle, uint32_t period);
-
+static uint32_t calculatePulseWidth(uint32_t duty, uint32_t widthPerDuty);
+static uint32_t calculateWidthPerDuty(uint32_t period);
+static bool isValidFrequency(uint32_t frequency);
+static int16_t limitDuty(int16_t duty, int16_t previousDuty, int16_t minDuty,
+                         uint16_t slewLimit);
+#ifdef BENCHMARK_ENABLED
+static void rotorsPeriodIntHandler(void);
+#endif
+
+
+//*****************************************************************************
+// Forces both rotors off, by resetting the PWM modules and driving the
+// rotor pins low as GPIO outputs. Should be called first thing at startup,
+// so the rotors are off whatever state the last reset left them in.
+//*****************************************************************************
+void rotorsForceOff(void) {
+    int i;
+    for (i = 0; i < BOARD_NUM_ROTORS; i++) {
+        const boardRotor_t* rotor = &rotors[i];
+
+        SysCtlPeripheralReset(rotor->pwmPeriph);
+        SysCtlPeripheralEnable(rotor->gpio.periph);
+        while (!SysCtlPeripheralReady(rotor->gpio.periph)) {
+            continue;
+        }
+
+        GPIOPinTypeGPIOOutput(rotor->gpio.base, rotor->gpio.pin);
+        GPIOPinWrite(rotor->gpio.base, rotor->gpio.pin, 0);
+    }
+}
 
 //*****************************************************************************
 // Performs all initialisation needed for the rotors module.
 //*****************************************************************************
 void initRotors() {
     SysCtlPWMClockSet(PWM_DIVIDER_CODE);
-    initialiseMainRotor();
-    initialiseTailRotor();
-}
 
-//*****************************************************************************
-// Performs initialisation for the main rotor.
-//*****************************************************************************
-static void initialiseMainRotor() {
-    SysCtlPeripheralEnable(PWM_MAIN_ROTOR_PERIPH_PWM);
-    SysCtlPeripheralEnable(PWM_MAIN_ROTOR_PERIPH_GPIO);
-
-    GPIOPinConfigure(PWM_MAIN_ROTOR_GPIO_CONFIG);
-    GPIOPinTypePWM(PWM_MAIN_ROTOR_GPIO_BASE, PWM_MAIN_ROTOR_GPIO_PIN);
-
-    PWMGenConfigure(PWM_MAIN_ROTOR_BASE,
-                    PWM_MAIN_ROTOR_GEN,
-                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
-
-    PWMGenEnable(PWM_MAIN_ROTOR_BASE, PWM_MAIN_ROTOR_GEN);
+    int i;
+    for (i = 0; i < BOARD_NUM_ROTORS; i++) {
+        initialiseRotor(&rotors[i]);
+    }
+    setRotorFrequency(PWM_ROTOR_FREQUENCY);
+    for (i = 0; i < BOARD_NUM_ROTORS; i++) {
+        PWMGenEnable(rotors[i].pwmBase, rotors[i].gen);
+    }
 
-    // Initially disable PWM output until rotor needs to start.
-    PWMOutputState(PWM_MAIN_ROTOR_BASE, PWM_MAIN_ROTOR_OUTBIT, false);
+    // Restart the counters of both generators together, so that their
+    // periods end at the same time, then latch the initial periods.
+    for (i = 0; i < BOARD_NUM_ROTORS; i++) {
+        PWMSyncTimeBase(rotors[i].pwmBase, rotors[i].genBit);
+    }
+    rotorsUpdate();
+
+#ifdef BENCHMARK_ENABLED
+    // Interrupt at the end of each main rotor PWM period, to measure the
+    // latency from an update being requested to it taking effect.
+    PWMGenIntRegister(mainRotor->pwmBase, mainRotor->gen,
+                      rotorsPeriodIntHandler);
+    PWMGenIntTrigEnable(mainRotor->pwmBase, mainRotor->gen, PWM_INT_CNT_ZERO);
+    PWMIntEnable(mainRotor->pwmBase, mainRotor->genInt);
+#endif
 }
 
 //*****************************************************************************
-// Performs initialisation for the tail rotor.
+// Performs initialisation for one rotor: configures its pin and PWM
+// generator, with the output initially disabled. The generator is enabled
+// once its period has been set.
 //*****************************************************************************
-static void initialiseTailRotor() {
-    SysCtlPeripheralEnable(PWM_TAIL_ROTOR_PERIPH_PWM);
-    SysCtlPeripheralEnable(PWM_TAIL_ROTOR_PERIPH_GPIO);
+static void initialiseRotor(const boardRotor_t* rotor) {
+    SysCtlPeripheralEnable(rotor->pwmPeriph);
+    SysCtlPeripheralEnable(rotor->gpio.periph);
 
-    GPIOPinConfigure(PWM_TAIL_ROTOR_GPIO_CONFIG);
-    GPIOPinTypePWM(PWM_TAIL_ROTOR_GPIO_BASE, PWM_TAIL_ROTOR_GPIO_PIN);
+    GPIOPinConfigure(rotor->pinConfig);
+    GPIOPinTypePWM(rotor->gpio.base, rotor->gpio.pin);
 
-    PWMGenConfigure(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_GEN,
-                        PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
-
-    PWMGenEnable(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_GEN);
+    PWMGenConfigure(rotor->pwmBase, rotor->gen, PWM_GEN_MODE);
 
     // Initially disable PWM output until rotor needs to start.
-    PWMOutputState(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_OUTBIT, false);
+    PWMOutputState(rotor->pwmBase, rotor->outBit, false);
 }
 
 //*****************************************************************************
-// Starts the main rotor, setting the duty cycle to the minimum value.
+// Starts the main rotor, setting the duty cycle to the minimum value. The
+// slew limit does not apply, as the rotor was previously off.
 //*****************************************************************************
 void startMainRotor() {
-    PWMOutputState(PWM_MAIN_ROTOR_BASE, PWM_MAIN_ROTOR_OUTBIT, true);
-    setMainRotorPower(PWM_MAIN_MIN_DUTY);
+    PWMOutputState(mainRotor->pwmBase, mainRotor->outBit, true);
+    mainRotorDuty = PWM_MAIN_MIN_DUTY * PWM_DUTY_SCALE;
+    setMainRotorDuty(mainRotorDuty);
+    rotorsUpdate();
 }
 
 //*****************************************************************************
-// Starts the tail rotor, setting the duty cycle to the minimum value.
+// Starts the tail rotor, setting the duty cycle to the minimum value. The
+// slew limit does not apply, as the rotor was previously off.
 //*****************************************************************************
 void startTailRotor() {
-    PWMOutputState(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_OUTBIT, true);
-    setTailRotorPower(PWM_TAIL_MIN_DUTY);
+    PWMOutputState(tailRotor->pwmBase, tailRotor->outBit, true);
+    tailRotorDuty = PWM_TAIL_MIN_DUTY * PWM_DUTY_SCALE;
+    setTailRotorDuty(tailRotorDuty);
+    rotorsUpdate();
 }
 
 //*****************************************************************************
 // Stops the main rotor, by disabling the PWM output.
 //*****************************************************************************
 void stopMainRotor() {
-    PWMOutputState(PWM_MAIN_ROTOR_BASE, PWM_MAIN_ROTOR_OUTBIT, false);
+    PWMOutputState(mainRotor->pwmBase, mainRotor->outBit, false);
 }
 
 //*****************************************************************************
 // Stops the tail rotor, by disabling the PWM output.
 //*****************************************************************************
 void stopTailRotor() {
-    PWMOutputState(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_OUTBIT, false);
+    PWMOutputState(tailRotor->pwmBase, tailRotor->outBit, false);
 }
 
 
 //*****************************************************************************
-// Calculates the period of the PWM signal (in clock ticks) for the given
+// Calculates the period of the PWM signal (in PWM clock ticks) for the given
 // frequency.
 //
 // frequency: The frequency in Hz.
-// returns:   The period in number of clock ticks.
+// returns:   The period in number of PWM clock ticks.
 //*****************************************************************************
 static uint32_t calculatePulsePeriod(uint32_t frequency) {
-    return SysCtlClockGet() / PWM_DIVIDER / frequency;
+    return clockRate() / PWM_DIVIDER / frequency;
 }
 
 //*****************************************************************************
 // Calculates the width of the PWM pulse (in PWM ticks) for the given
-// duty cycle and period.
+// duty cycle, using the precomputed width per unit of duty cycle.
+//
+// duty:          The duty cycle of the PWM signal, in PWM_DUTY_SCALE units.
+// widthPerDuty:  The pulse width per unit of duty cycle, scaled by
+//                2^PWM_WIDTH_SHIFT.
+// returns:       The width of the PWM pulse in number of PWM clock ticks.
+//*****************************************************************************
+static uint32_t calculatePulseWidth(uint32_t duty, uint32_t widthPerDuty) {
+    return (duty * widthPerDuty) >> PWM_WIDTH_SHIFT;
+}
+
+//*****************************************************************************
+// Calculates the width of the PWM pulse per unit of duty cycle, scaled by
+// 2^PWM_WIDTH_SHIFT, for the given period.
 //
-// dutyCycle: The duty cycle of the PWM signal.
-// period:    The period of the PWM signal in number of clock ticks.
-// returns:   The width of the PWM pulse in number of PWM clock ticks.
+// period:  The period of the PWM signal in number of PWM clock ticks.
+// returns: The scaled pulse width per unit of duty cycle.
+//*****************************************************************************
+static uint32_t calculateWidthPerDuty(uint32_t period) {
+    return ((uint64_t) period << PWM_WIDTH_SHIFT) / (100 * PWM_DUTY_SCALE);
+}
+
+//*****************************************************************************
+// Checks whether the given PWM frequency gives a period which fits in the
+// PWM generator counter and keeps the full duty cycle resolution.
+//*****************************************************************************
+static bool isValidFrequency(uint32_t frequency) {
+    if (frequency == 0) {
+        return false;
+    }
+    uint32_t period = calculatePulsePeriod(frequency);
+    return period >= PWM_MIN_PERIOD && period <= PWM_MAX_PERIOD;
+}
+
+//*****************************************************************************
+// Limits a new duty cycle to within slewLimit of the previous duty cycle
+// (if slewLimit is non-zero), and to within the allowed range.
 //*****************************************************************************
-static uint32_t calculatePulseWidth(uint32_t dutyCycle, uint32_t period) {
-    return period * dutyCycle / 100;
+static int16_t limitDuty(int16_t duty, int16_t previousDuty, int16_t minDuty,
+                         uint16_t slewLimit) {
+    if (slewLimit != 0) {
+        if (duty > previousDuty + slewLimit) {
+            duty = previousDuty + slewLimit;
+        } else if (duty < previousDuty - slewLimit) {
+            duty = previousDuty - slewLimit;
+        }
+    }
+
+    if (duty > PWM_MAX_DUTY * PWM_DUTY_SCALE) {
+        duty = PWM_MAX_DUTY * PWM_DUTY_SCALE;
+    } else if (duty < minDuty) {
+        duty = minDuty;
+    }
+    return duty;
+}
+
+//*****************************************************************************
+// Sets the PWM frequency of both rotors, keeping their current duty cycles.
+// Takes effect at the end of the PWM period after the next call to
+// rotorsUpdate.
+//
+// frequency: The PWM frequency in Hz.
+// returns:   false if the frequency is out of range, in which case it is
+//            not changed.
+//*****************************************************************************
+bool setRotorFrequency(uint32_t frequency) {
+    if (!isValidFrequency(frequency)) {
+        return false;
+    }
+
+    // The control update sets the duty cycles from the period and pulse
+    // widths, so they are all changed together with interrupts disabled.
+    bool interruptsDisabled = IntMasterDisable();
+
+    pulsePeriod = calculatePulsePeriod(frequency);
+    widthPerDuty = calculateWidthPerDuty(pulsePeriod);
+    PWMGenPeriodSet(mainRotor->pwmBase, mainRotor->gen, pulsePeriod);
+    PWMGenPeriodSet(tailRotor->pwmBase, tailRotor->gen, pulsePeriod);
+
+    // The compare values depend on the period, so always rewrite them.
+    mainPulseWidth = calculatePulseWidth(mainRotorDuty, widthPerDuty);
+    tailPulseWidth = calculatePulseWidth(tailRotorDuty, widthPerDuty);
+    PWMPulseWidthSet(mainRotor->pwmBase, mainRotor->outNum,
+                     mainPulseWidth);
+    PWMPulseWidthSet(tailRotor->pwmBase, tailRotor->outNum,
+                     tailPulseWidth);
+
+    if (!interruptsDisabled) {
+        IntMasterEnable();
+    }
+    return true;
+}
+
+//*****************************************************************************
+// Sets the largest change in the main rotor duty cycle per call to
+// setMainRotorDuty, i.e. per control update.
+//
+// slewLimit: The limit in PWM_DUTY_SCALE units, or zero for no limit.
+//*****************************************************************************
+void setMainRotorSlewLimit(uint16_t slewLimit) {
+    mainSlewLimit = slewLimit;
+}
+
+//*****************************************************************************
+// Sets the largest change in the tail rotor duty cycle per call to
+// setTailRotorDuty, i.e. per control update.
+//
+// slewLimit: The limit in PWM_DUTY_SCALE units, or zero for no limit.
+//*****************************************************************************
+void setTailRotorSlewLimit(uint16_t slewLimit) {
+    tailSlewLimit = slewLimit;
 }
 
 //*****************************************************************************
@@ -179,17 +374,7 @@ static uint32_t calculatePulseWidth(uint32_t dutyCycle, uint32_t period) {
 // power: The power level percentage to set the main rotor to.
 //*****************************************************************************
 void setMainRotorPower(int16_t power) {
-    if (power > PWM_MAX_DUTY) {
-        power = PWM_MAX_DUTY;
-    } else if (power < PWM_MAIN_MIN_DUTY) {
-        power = PWM_MAIN_MIN_DUTY;
-    }
-    uint32_t pulsePeriod = calculatePulsePeriod(PWM_MAIN_ROTOR_FREQUENCY);
-    uint32_t pulseWidth = calculatePulseWidth(power, pulsePeriod);
-
-    PWMGenPeriodSet(PWM_MAIN_ROTOR_BASE, PWM_MAIN_ROTOR_GEN, pulsePeriod);
-    PWMPulseWidthSet(PWM_MAIN_ROTOR_BASE, PWM_MAIN_ROTOR_OUTNUM, pulseWidth);
-    mainRotorPower = power;
+    setMainRotorDuty(power * PWM_DUTY_SCALE);
 }
 
 //*****************************************************************************
@@ -198,33 +383,120 @@ void setMainRotorPower(int16_t power) {
 // power: The power level percentage to set the tail rotor to.
 //*****************************************************************************
 void setTailRotorPower(int16_t power) {
-    if (power > PWM_MAX_DUTY) {
-        power = PWM_MAX_DUTY;
-    } else if (power < PWM_TAIL_MIN_DUTY) {
-        power = PWM_TAIL_MIN_DUTY;
+    setTailRotorDuty(power * PWM_DUTY_SCALE);
+}
+
+//*****************************************************************************
+// Sets the duty cycle of the main rotor, limited by the slew limit. The
+// pulse width register is only written if the pulse width has changed.
+// Takes effect at the end of the PWM period after the next call to
+// rotorsUpdate.
+//
+// duty:    The duty cycle to set the main rotor to, in PWM_DUTY_SCALE units.
+// returns: The duty cycle actually set, after the slew and range limits.
+//*****************************************************************************
+int16_t setMainRotorDuty(int16_t duty) {
+    duty = limitDuty(duty, mainRotorDuty, PWM_MAIN_MIN_DUTY * PWM_DUTY_SCALE,
+                     mainSlewLimit);
+    uint32_t pulseWidth = calculatePulseWidth(duty, widthPerDuty);
+
+    if (pulseWidth != mainPulseWidth) {
+        PWMPulseWidthSet(mainRotor->pwmBase, mainRotor->outNum,
+                         pulseWidth);
+        mainPulseWidth = pulseWidth;
     }
-    uint32_t pulsePeriod = calculatePulsePeriod(PWM_TAIL_ROTOR_FREQUENCY);
-    uint32_t pulseWidth = calculatePulseWidth(power, pulsePeriod);
+    mainRotorDuty = duty;
+    return duty;
+}
 
-    PWMGenPeriodSet(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_GEN, pulsePeriod);
-    PWMPulseWidthSet(PWM_TAIL_ROTOR_BASE, PWM_TAIL_ROTOR_OUTNUM, pulseWidth);
-    tailRotorPower = power;
+//*****************************************************************************
+// Sets the duty cycle of the tail rotor, limited by the slew limit. The
+// pulse width register is only written if the pulse width has changed.
+// Takes effect at the end of the PWM period after the next call to
+// rotorsUpdate.
+//
+// duty:    The duty cycle to set the tail rotor to, in PWM_DUTY_SCALE units.
+// returns: The duty cycle actually set, after the slew and range limits.
+//*****************************************************************************
+int16_t setTailRotorDuty(int16_t duty) {
+    duty = limitDuty(duty, tailRotorDuty, PWM_TAIL_MIN_DUTY * PWM_DUTY_SCALE,
+                     tailSlewLimit);
+    uint32_t pulseWidth = calculatePulseWidth(duty, widthPerDuty);
+
+    if (pulseWidth != tailPulseWidth) {
+        PWMPulseWidthSet(tailRotor->pwmBase, tailRotor->outNum,
+                         pulseWidth);
+        tailPulseWidth = pulseWidth;
+    }
+    tailRotorDuty = duty;
+    return duty;
 }
 
+//*****************************************************************************
+// Applies the duty cycles set since the last call for both rotors together,
+// at the end of the current PWM period. Should be called once both duty
+// cycles have been set.
+//*****************************************************************************
+void rotorsUpdate(void) {
+    PWMSyncUpdate(mainRotor->pwmBase, mainRotor->genBit);
+    PWMSyncUpdate(tailRotor->pwmBase, tailRotor->genBit);
+
+#ifdef BENCHMARK_ENABLED
+    updateRequestTime = CYCLE_COUNTER;
+    updatePending = true;
+#endif
+}
+
+#ifdef BENCHMARK_ENABLED
+//*****************************************************************************
+// The interrupt handler for the end of each main rotor PWM period, when any
+// pending update is latched. Records the time since it was requested.
+//*****************************************************************************
+static void rotorsPeriodIntHandler(void) {
+    PWMGenIntClear(mainRotor->pwmBase, mainRotor->gen, PWM_INT_CNT_ZERO);
+
+    if (updatePending) {
+        benchmarkRecord(BENCH_ACTUATOR_LATENCY,
+                        CYCLE_COUNTER - updateRequestTime);
+        updatePending = false;
+    }
+}
+#endif
+
 //*****************************************************************************
 // Gets the power of the main rotor.
 //
-// returns: The power level percentage of the main rotor.
+// returns: The power level percentage of the main rotor, rounded to the
+//          nearest percent.
 //*****************************************************************************
 uint16_t getMainRotorPower() {
-    return mainRotorPower;
+    return (mainRotorDuty + PWM_DUTY_SCALE / 2) / PWM_DUTY_SCALE;
 }
 
 //*****************************************************************************
 // Gets the power of the tail rotor.
 //
-// returns: The power level percentage of the tail rotor.
+// returns: The power level percentage of the tail rotor, rounded to the
+//          nearest percent.
 //*****************************************************************************
 uint16_t getTailRotorPower() {
-    return tailRotorPower;
+    return (tailRotorDuty + PWM_DUTY_SCALE / 2) / PWM_DUTY_SCALE;
+}
+
+//*****************************************************************************
+// Gets the duty cycle of the main rotor.
+//
+// returns: The duty cycle of the main rotor, in PWM_DUTY_SCALE units.
+//*****************************************************************************
+uint16_t getMainRotorDuty() {
+    return mainRotorDuty;
+}
+
+//*****************************************************************************
+// Gets the duty cycle of the tail rotor.
+//
+// returns: The duty cycle of the tail rotor, in PWM_DUTY_SCALE units.
+//*****************************************************************************
+uint16_t getTailRotorDuty() {
+    return tailRotorDuty;
 }
@@ -26,6 +26,16 @@
 #define PWM_MAIN_MIN_DUTY   20
 #define PWM_TAIL_MIN_DUTY   5
 
+// Duty cycles can be set in units of 1 / PWM_DUTY_SCALE percent.
+#define PWM_DUTY_SCALE      10
+
+
+//*****************************************************************************
+// Forces both rotors off, by resetting the PWM modules and driving the
+// rotor pins low as GPIO outputs. Should be called first thing at startup,
+// so the rotors are off whatever state the last reset left them in.
+//*****************************************************************************
+void rotorsForceOff(void);
 
 //*****************************************************************************
 // Performs all initialisation needed for the rotors module.
@@ -66,18 +76,91 @@ void setMainRotorPower(int16_t power);
 //*****************************************************************************
 void setTailRotorPower(int16_t power);
 
+//*****************************************************************************
+// Sets the duty cycle of the main rotor, limited by the slew limit. The
+// pulse width register is only written if the pulse width has changed.
+// Takes effect at the end of the PWM period after the next call to
+// rotorsUpdate.
+//
+// duty:    The duty cycle to set the main rotor to, in PWM_DUTY_SCALE units.
+// returns: The duty cycle actually set, after the slew and range limits.
+//*****************************************************************************
+int16_t setMainRotorDuty(int16_t duty);
+
+//*****************************************************************************
+// Sets the duty cycle of the tail rotor, limited by the slew limit. The
+// pulse width register is only written if the pulse width has changed.
+// Takes effect at the end of the PWM period after the next call to
+// rotorsUpdate.
+//
+// duty:    The duty cycle to set the tail rotor to, in PWM_DUTY_SCALE units.
+// returns: The duty cycle actually set, after the slew and range limits.
+//*****************************************************************************
+int16_t setTailRotorDuty(int16_t duty);
+
+//*****************************************************************************
+// Sets the PWM frequency of both rotors, keeping their current duty cycles.
+// Both rotors share one frequency, so that updates to both are latched at
+// the same period boundary. Takes effect at the end of the PWM period after
+// the next call to rotorsUpdate.
+//
+// frequency: The PWM frequency in Hz.
+// returns:   false if the frequency is out of range, in which case it is
+//            not changed.
+//*****************************************************************************
+bool setRotorFrequency(uint32_t frequency);
+
+//*****************************************************************************
+// Sets the largest change in the main rotor duty cycle per call to
+// setMainRotorDuty, i.e. per control update.
+//
+// slewLimit: The limit in PWM_DUTY_SCALE units, or zero for no limit.
+//*****************************************************************************
+void setMainRotorSlewLimit(uint16_t slewLimit);
+
+//*****************************************************************************
+// Sets the largest change in the tail rotor duty cycle per call to
+// setTailRotorDuty, i.e. per control update.
+//
+// slewLimit: The limit in PWM_DUTY_SCALE units, or zero for no limit.
+//*****************************************************************************
+void setTailRotorSlewLimit(uint16_t slewLimit);
+
+//*****************************************************************************
+// Applies the duty cycles set since the last call for both rotors together,
+// at the end of the current PWM period. Should be called once both duty
+// cycles have been set.
+//*****************************************************************************
+void rotorsUpdate(void);
+
 //*****************************************************************************
 // Gets the power of the main rotor.
 //
-// returns: The power level percentage of the main rotor.
+// returns: The power level percentage of the main rotor, rounded to the
+//          nearest percent.
 //*****************************************************************************
 uint16_t getMainRotorPower();
 
 //*****************************************************************************
 // Gets the power of the tail rotor.
 //
-// returns: The power level percentage of the tail rotor.
+// returns: The power level percentage of the tail rotor, rounded to the
+//          nearest percent.
 //*****************************************************************************
 uint16_t getTailRotorPower();
 
+//*****************************************************************************
+// Gets the duty cycle of the main rotor.
+//
+// returns: The duty cycle of the main rotor, in PWM_DUTY_SCALE units.
+//*****************************************************************************
+uint16_t getMainRotorDuty();
+
+//*****************************************************************************
+// Gets the duty cycle of the tail rotor.
+//
+// returns: The duty cycle of the tail rotor, in PWM_DUTY_SCALE units.
+//*****************************************************************************
+uint16_t getTailRotorDuty();
+
 #endif  // ROTORS_H_
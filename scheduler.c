@@ -15,6 +15,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include "cycleCounter.h"
+#include "watchdog.h"
 
 #include "scheduler.h"
 
@@ -23,12 +25,19 @@
 // Task structure, containing a callback to run the task, the number of ticks
 // after which the task should be run, a counter to keep track of the current
 // number of ticks, and a flag indicating whether it's time to run the task.
+// Critical tasks also have a deadline, the number of ticks within which the
+// task must have last finished for the scheduler to be considered alive.
+// When WCET_ENABLED is defined, the longest time taken to run the task is
+// also measured.
 //*****************************************************************************
 typedef struct {
     void (*runTask)(void);
     uint16_t ticksPerRun;
     uint16_t tick;
     bool ready;
+    uint16_t deadlineTicks;     // Zero if not critical
+    uint32_t lastRunTick;
+    uint32_t maxCycles;
 } task_t;
 
 
@@ -37,6 +46,10 @@ typedef struct {
 //*****************************************************************************
 static task_t* tasks;
 static uint16_t numTasks;
+static uint16_t numRegistered = 0;
+
+// Number of ticks since startup.
+static volatile uint32_t numTicks = 0;
 
 
 //*****************************************************************************
@@ -53,20 +66,37 @@ void initScheduler(uint16_t numberOfTasks) {
 // priorities should be registered first.
 //*****************************************************************************
 void schedulerRegisterTask(void (*runTask)(void), uint16_t ticksPerRun) {
-    static uint16_t taskIndex = 0;
-
-    if (taskIndex >= numTasks) {
+    if (numRegistered >= numTasks) {
         // Error: too many tasks registered.
         return;
     }
 
-    task_t* newTask = &tasks[taskIndex];
+    task_t* newTask = &tasks[numRegistered];
     newTask->runTask = runTask;
     newTask->ticksPerRun = ticksPerRun;
     newTask->tick = 0;
     newTask->ready = false;
+    newTask->deadlineTicks = 0;
+    newTask->lastRunTick = 0;
+    newTask->maxCycles = 0;
+
+    numRegistered++;
+}
+
+//*****************************************************************************
+// Registers a task as with schedulerRegisterTask, which is also critical:
+// the scheduler is only considered alive while the task has finished
+// within the last deadlineTicks ticks.
+//*****************************************************************************
+void schedulerRegisterCriticalTask(void (*runTask)(void), uint16_t ticksPerRun,
+                                   uint16_t deadlineTicks) {
+    if (numRegistered >= numTasks) {
+        // Error: too many tasks registered.
+        return;
+    }
 
-    taskIndex++;
+    schedulerRegisterTask(runTask, ticksPerRun);
+    tasks[numRegistered - 1].deadlineTicks = deadlineTicks;
 }
 
 //*****************************************************************************
@@ -74,6 +104,8 @@ void schedulerRegisterTask(void (*runTask)(void), uint16_t ticksPerRun) {
 // Should be called frequently, e.g. from a SysTick interrupt handler.
 //*****************************************************************************
 void schedulerUpdateTicks(void) {
+    numTicks++;
+
     uint16_t i = 0;
     for (i = 0; i < numTasks; i++) {
         task_t* task = &tasks[i];
@@ -92,16 +124,74 @@ void schedulerUpdateTicks(void) {
 // task priorities.
 //*****************************************************************************
 void schedulerStart(void) {
+    // Deadlines are measured from when the scheduler starts.
+    uint16_t i = 0;
+    for (i = 0; i < numRegistered; i++) {
+        tasks[i].lastRunTick = numTicks;
+    }
+
     while (true) {
-        uint16_t i = 0;
         for (i = 0; i < numTasks; i++) {
             task_t* task = &tasks[i];
             if (task->ready) {
                 task->ready = false;
+                // Kept over a reset, to show which task was running if
+                // the watchdog expires.
+                watchdogRecordTask(i);
+#ifdef WCET_ENABLED
+                uint32_t start = CYCLE_COUNTER;
                 task->runTask();
+                uint32_t cycles = CYCLE_COUNTER - start;
+                if (cycles > task->maxCycles) {
+                    task->maxCycles = cycles;
+                }
+#else
+                task->runTask();
+#endif
+                task->lastRunTick = numTicks;
                 break;
             }
         }
     }
 }
 
+//*****************************************************************************
+// Returns the number of tasks which have been registered.
+//*****************************************************************************
+uint16_t schedulerNumTasks(void) {
+    return numRegistered;
+}
+
+//*****************************************************************************
+// Returns the number of ticks per execution of the given task.
+//*****************************************************************************
+uint16_t schedulerTaskTicksPerRun(uint16_t taskIndex) {
+    return tasks[taskIndex].ticksPerRun;
+}
+
+//*****************************************************************************
+// Returns the longest time taken to run the given task, in cycles. Only
+// measured when WCET_ENABLED is defined, otherwise zero. Includes the time
+// spent in any interrupt handlers which ran during the task.
+//*****************************************************************************
+uint32_t schedulerTaskMaxCycles(uint16_t taskIndex) {
+    return tasks[taskIndex].maxCycles;
+}
+
+//*****************************************************************************
+// Returns whether every critical task has finished within its deadline.
+//*****************************************************************************
+bool schedulerCriticalTasksAlive(void) {
+    uint32_t now = numTicks;
+
+    uint16_t i = 0;
+    for (i = 0; i < numRegistered; i++) {
+        task_t* task = &tasks[i];
+        if (task->deadlineTicks != 0
+                && now - task->lastRunTick > task->deadlineTicks) {
+            return false;
+        }
+    }
+    return true;
+}
+
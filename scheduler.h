@@ -28,6 +28,14 @@ void initScheduler(uint16_t numberOfTasks);
 //*****************************************************************************
 void schedulerRegisterTask(void (*runTask)(void), uint16_t ticksPerRun);
 
+//*****************************************************************************
+// Registers a task as with schedulerRegisterTask, which is also critical:
+// the scheduler is only considered alive while the task has finished
+// within the last deadlineTicks ticks.
+//*****************************************************************************
+void schedulerRegisterCriticalTask(void (*runTask)(void), uint16_t ticksPerRun,
+                                   uint16_t deadlineTicks);
+
 //*****************************************************************************
 // Updates the ticks of each task, setting the task to ready if necessary.
 // Should be called frequently, e.g. from a SysTick interrupt handler.
@@ -42,5 +50,27 @@ void schedulerUpdateTicks(void);
 //*****************************************************************************
 void schedulerStart(void);
 
+//*****************************************************************************
+// Returns the number of tasks which have been registered.
+//*****************************************************************************
+uint16_t schedulerNumTasks(void);
+
+//*****************************************************************************
+// Returns the number of ticks per execution of the given task.
+//*****************************************************************************
+uint16_t schedulerTaskTicksPerRun(uint16_t taskIndex);
+
+//*****************************************************************************
+// Returns the longest time taken to run the given task, in cycles. Only
+// measured when WCET_ENABLED is defined, otherwise zero. Includes the time
+// spent in any interrupt handlers which ran during the task.
+//*****************************************************************************
+uint32_t schedulerTaskMaxCycles(uint16_t taskIndex);
+
+//*****************************************************************************
+// Returns whether every critical task has finished within its deadline.
+//*****************************************************************************
+bool schedulerCriticalTasksAlive(void);
+
 
 #endif  // SCHEDULER_H_
@@ -6,7 +6,8 @@
 //          Matthew Toohey (mct63)
 //          James Brazier (jbr185)
 //
-// Module for Switch 1 on the ORBIT daughter board.
+// Module for Switch 1 on the ORBIT daughter board. The switch is read from
+// a timer interrupt once it has settled after an edge, rather than polled.
 //
 //*****************************************************************************
 
@@ -16,6 +17,12 @@
 #include "inc/hw_types.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "board.h"
+#include "inputCapture.h"
+#include "yaw.h"
+#include "clock.h"
+#include "wcet.h"
 
 #include "switch.h"
 
@@ -23,42 +30,118 @@
 //*****************************************************************************
 // Constants
 //*****************************************************************************
-#define SWITCH_1_PERIPH     SYSCTL_PERIPH_GPIOA
-#define SWITCH_1_PORT_BASE  GPIO_PORTA_BASE
-#define SWITCH_1_PIN        GPIO_PIN_7
+// The first edge starts a one-shot timer, after which the switch is read.
+// Further edges are masked until then.
+#define SWITCH_DEBOUNCE_MS  10
+#define SWITCH_TIMER_PERIPH SYSCTL_PERIPH_TIMER3
+#define SWITCH_TIMER_BASE   TIMER3_BASE
+#define SWITCH_TIMER        TIMER_A
+#define SWITCH_TIMER_INT_FLAG   TIMER_TIMA_TIMEOUT
 
 
 //*****************************************************************************
 // Static variables
 //*****************************************************************************
 
+static const boardPin_t switchPin = BOARD_SWITCH;
+
 // Current position of the switch, true means up.
 bool switchPosition;
 
 // Whether the switch position has changed since the last call to checkSwitch1
 bool switchPositionChanged = false;
 
+// Time of the first edge which started the debounce timer.
+// Units: yaw timer ticks
+static uint32_t edgeTimestamp;
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static void switchEdgeIntHandler(void);
+static void switchDebounceIntHandler(void);
+static void setSwitchPosition(bool newSwitchPosition);
+
 
 //*****************************************************************************
 // Performs initialisation for the main switch.
 //*****************************************************************************
 void initSwitch() {
-    SysCtlPeripheralEnable(SWITCH_1_PERIPH);
-    GPIOPinTypeGPIOInput(SWITCH_1_PORT_BASE, SWITCH_1_PIN);
-    GPIOPadConfigSet(SWITCH_1_PORT_BASE, SWITCH_1_PIN, GPIO_STRENGTH_2MA,
+    SysCtlPeripheralEnable(switchPin.periph);
+    GPIOPinTypeGPIOInput(switchPin.base, switchPin.pin);
+    GPIOPadConfigSet(switchPin.base, switchPin.pin, GPIO_STRENGTH_2MA,
                      GPIO_PIN_TYPE_STD_WPD);
-    switchPosition = GPIOPinRead(SWITCH_1_PORT_BASE, SWITCH_1_PIN)
-                      == SWITCH_1_PIN;
+    switchPosition = GPIOPinRead(switchPin.base, switchPin.pin)
+                      == switchPin.pin;
+
+    SysCtlPeripheralEnable(SWITCH_TIMER_PERIPH);
+    TimerConfigure(SWITCH_TIMER_BASE, TIMER_CFG_ONE_SHOT);
+    TimerIntRegister(SWITCH_TIMER_BASE, SWITCH_TIMER,
+                     switchDebounceIntHandler);
+    TimerIntEnable(SWITCH_TIMER_BASE, SWITCH_TIMER_INT_FLAG);
+
+    GPIOIntRegister(switchPin.base, switchEdgeIntHandler);
+    GPIOIntTypeSet(switchPin.base, switchPin.pin, GPIO_BOTH_EDGES);
+    GPIOIntClear(switchPin.base, switchPin.pin);
+    GPIOIntEnable(switchPin.base, switchPin.pin);
 }
 
 //*****************************************************************************
-// Checks if the switch position has changed since the last call, and updates
-// the switch state as necessary. Should be called frequently, e.g. from a
-// SysTickIntHandler.
+// The handler for an edge on the switch pin. Timestamps the edge and starts
+// the debounce timer, masking the switch interrupt until it expires.
+//*****************************************************************************
+static void switchEdgeIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_INPUT_EDGE);
+    GPIOIntDisable(switchPin.base, switchPin.pin);
+
+    edgeTimestamp = yawTimestamp();
+    TimerLoadSet(SWITCH_TIMER_BASE, SWITCH_TIMER,
+                 clockRate() / 1000 * SWITCH_DEBOUNCE_MS);
+    TimerEnable(SWITCH_TIMER_BASE, SWITCH_TIMER);
+    WCET_ISR_EXIT(WCET_ISR_INPUT_EDGE);
+}
+
+//*****************************************************************************
+// The handler for the debounce timer. Reads the settled switch position and
+// unmasks the switch interrupt, clearing any edges latched while masked.
+//*****************************************************************************
+static void switchDebounceIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_INPUT_DEBOUNCE);
+    TimerIntClear(SWITCH_TIMER_BASE, SWITCH_TIMER_INT_FLAG);
+
+    GPIOIntClear(switchPin.base, switchPin.pin);
+    updateSwitch1();
+    GPIOIntEnable(switchPin.base, switchPin.pin);
+    WCET_ISR_EXIT(WCET_ISR_INPUT_DEBOUNCE);
+}
+
+//*****************************************************************************
+// Reads the switch and updates the switch state. Called once the debounce
+// interval has passed since an edge, so the pin has settled.
 //*****************************************************************************
 void updateSwitch1(void) {
-    bool newSwitchPosition = GPIOPinRead(SWITCH_1_PORT_BASE, SWITCH_1_PIN)
-                              == SWITCH_1_PIN;
+    bool newSwitchPosition = GPIOPinRead(switchPin.base, switchPin.pin)
+                             == switchPin.pin;
+
+    inputCaptureRecordChangeAt(CAPTURE_SWITCH, newSwitchPosition,
+                               edgeTimestamp);
+    setSwitchPosition(newSwitchPosition);
+}
+
+//*****************************************************************************
+// Updates the switch state from the given position (true means up). Used
+// when replaying captured switch inputs.
+//*****************************************************************************
+void updateSwitch1FromPosition(bool newSwitchPosition) {
+    inputCaptureRecordChange(CAPTURE_SWITCH, newSwitchPosition);
+    setSwitchPosition(newSwitchPosition);
+}
+
+//*****************************************************************************
+// Sets the switch position, flagging a change if it differs from the last.
+//*****************************************************************************
+static void setSwitchPosition(bool newSwitchPosition) {
     if (newSwitchPosition != switchPosition) {
         switchPositionChanged = true;
     }
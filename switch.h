@@ -6,7 +6,8 @@
 //          Matthew Toohey (mct63)
 //          James Brazier (jbr185)
 //
-// Module for Switch 1 on the ORBIT daughter board.
+// Module for Switch 1 on the ORBIT daughter board. The switch is read from
+// a timer interrupt once it has settled after an edge, rather than polled.
 //
 //*****************************************************************************
 
@@ -26,12 +27,17 @@ typedef enum switchStates switchState_t;
 void initSwitch();
 
 //*****************************************************************************
-// Checks if the switch position has changed since the last call, and updates
-// the switch state as necessary. Should be called frequently, e.g. from a
-// SysTickIntHandler.
+// Reads the switch and updates the switch state. Called once the debounce
+// interval has passed since an edge, so the pin has settled.
 //*****************************************************************************
 void updateSwitch1(void);
 
+//*****************************************************************************
+// Updates the switch state from the given position (true means up). Used
+// when replaying captured switch inputs.
+//*****************************************************************************
+void updateSwitch1FromPosition(bool newSwitchPosition);
+
 //*****************************************************************************
 // Returns the current state of the switch, indicating whether it has been
 // switched up or down, or is unchanged since the last call to this function.
@@ -0,0 +1,175 @@
+//*****************************************************************************
+//
+// File: trajectory.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which turns changes in a target value (e.g. the desired altitude or
+// yaw) into a smooth reference profile, limited in both rate and
+// acceleration, which is evaluated at the control update rate.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "trajectory.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Fixed-point scale of the stored positions and velocities.
+#define TRAJECTORY_SCALE    256
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static int32_t wrapToRange(trajectory_t* traj, int32_t value);
+
+
+//*****************************************************************************
+// Initialises a trajectory with the given rate and acceleration limits
+// (in units per second and units per second squared), starting at rest at
+// zero. If wrapRange is non-zero, values are taken to wrap around in the
+// range -wrapRange / 2 to wrapRange / 2, e.g. 360 for an angle in degrees.
+//*****************************************************************************
+void initTrajectory(trajectory_t* traj, int16_t maxRate, int16_t maxAccel,
+                    int16_t wrapRange) {
+    traj->maxRate = (int32_t) maxRate * TRAJECTORY_SCALE;
+    traj->maxAccel = (int32_t) maxAccel * TRAJECTORY_SCALE;
+    traj->wrapRange = (int32_t) wrapRange * TRAJECTORY_SCALE;
+    trajectoryReset(traj, 0);
+}
+
+//*****************************************************************************
+// Changes the rate and acceleration limits (in units per second and units
+// per second squared). If the reference is moving faster than the new rate
+// limit, it slows down at the acceleration limit rather than immediately.
+//*****************************************************************************
+void trajectorySetLimits(trajectory_t* traj, int16_t maxRate,
+                         int16_t maxAccel) {
+    traj->maxRate = (int32_t) maxRate * TRAJECTORY_SCALE;
+    traj->maxAccel = (int32_t) maxAccel * TRAJECTORY_SCALE;
+}
+
+//*****************************************************************************
+// Moves the reference and target to the given value immediately, at rest.
+//*****************************************************************************
+void trajectoryReset(trajectory_t* traj, int16_t position) {
+    traj->position = (int32_t) position * TRAJECTORY_SCALE;
+    traj->target = traj->position;
+    traj->velocity = 0;
+}
+
+//*****************************************************************************
+// Moves the reference and target by the given amount (in hundredths of a
+// unit) immediately, keeping the current velocity. Used when the frame of
+// reference changes, e.g. when a reference position is found.
+//*****************************************************************************
+void trajectoryShift(trajectory_t* traj, int32_t amount) {
+    int32_t shift = (int64_t) amount * TRAJECTORY_SCALE / 100;
+    traj->position = wrapToRange(traj, traj->position + shift);
+    traj->target = wrapToRange(traj, traj->target + shift);
+}
+
+//*****************************************************************************
+// Sets the value which the reference will move towards.
+//*****************************************************************************
+void trajectorySetTarget(trajectory_t* traj, int16_t target) {
+    traj->target = (int32_t) target * TRAJECTORY_SCALE;
+}
+
+//*****************************************************************************
+// Returns the value which the reference is moving towards.
+//*****************************************************************************
+int16_t trajectoryTarget(trajectory_t* traj) {
+    return traj->target / TRAJECTORY_SCALE;
+}
+
+//*****************************************************************************
+// Advances the reference by one update period. The reference accelerates
+// towards the target until its stopping distance reaches the remaining
+// distance, then decelerates, never exceeding the rate limit.
+//*****************************************************************************
+void trajectoryUpdate(trajectory_t* traj, uint16_t updateRate) {
+    int32_t distance = wrapToRange(traj, traj->target - traj->position);
+    int32_t direction = (distance >= 0) ? 1 : -1;
+    int32_t velocityStep = traj->maxAccel / updateRate;
+
+    // Distance and velocity measured in the direction of the target.
+    int32_t remaining = distance * direction;
+    int32_t velocity = traj->velocity * direction;
+
+    // Finish exactly on the target once it can be reached in one step. Since
+    // the reference decelerates on approach, the velocity is small by then.
+    if (remaining * updateRate <= velocity + velocityStep) {
+        traj->position = traj->target;
+        traj->velocity = 0;
+        return;
+    }
+
+    int32_t stoppingDistance = velocity * velocity / (2 * traj->maxAccel);
+    if (velocity > 0 && stoppingDistance >= remaining) {
+        velocity -= velocityStep;
+    } else if (velocity > traj->maxRate) {
+        // The rate limit has been reduced, so slow down to it.
+        velocity -= velocityStep;
+        if (velocity < traj->maxRate) {
+            velocity = traj->maxRate;
+        }
+    } else {
+        velocity += velocityStep;
+        if (velocity > traj->maxRate) {
+            velocity = traj->maxRate;
+        }
+    }
+
+    if (velocity < -traj->maxRate) {
+        velocity = -traj->maxRate;
+    }
+
+    traj->velocity = velocity * direction;
+    traj->position = wrapToRange(traj,
+                                 traj->position + traj->velocity / updateRate);
+}
+
+//*****************************************************************************
+// Returns the current reference value, rounded to the nearest whole unit.
+//*****************************************************************************
+int16_t trajectoryPosition(trajectory_t* traj) {
+    if (traj->position >= 0) {
+        return (traj->position + TRAJECTORY_SCALE / 2) / TRAJECTORY_SCALE;
+    } else {
+        return (traj->position - TRAJECTORY_SCALE / 2) / TRAJECTORY_SCALE;
+    }
+}
+
+//*****************************************************************************
+// Returns true if the reference has reached the target and is at rest.
+//*****************************************************************************
+bool trajectoryFinished(trajectory_t* traj) {
+    return traj->position == traj->target && traj->velocity == 0;
+}
+
+//*****************************************************************************
+// If the trajectory wraps, converts the given fixed-point value to an
+// equivalent value in the range -wrapRange / 2 to wrapRange / 2.
+//*****************************************************************************
+static int32_t wrapToRange(trajectory_t* traj, int32_t value) {
+    if (traj->wrapRange == 0) {
+        return value;
+    }
+
+    value %= traj->wrapRange;
+    if (value < -traj->wrapRange / 2) {
+        value += traj->wrapRange;
+    } else if (value >= traj->wrapRange / 2) {
+        value -= traj->wrapRange;
+    }
+    return value;
+}
@@ -0,0 +1,89 @@
+//*****************************************************************************
+//
+// File: trajectory.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which turns changes in a target value (e.g. the desired altitude or
+// yaw) into a smooth reference profile, limited in both rate and
+// acceleration, which is evaluated at the control update rate.
+//
+//*****************************************************************************
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+
+//*****************************************************************************
+// Trajectory structure. Positions and velocities are stored in fixed-point,
+// as TRAJECTORY_SCALE times the value in the units of the target.
+//*****************************************************************************
+typedef struct {
+    int32_t position;      // Current reference value
+    int32_t velocity;      // Units: per second
+    int32_t target;        // Value the reference is moving towards
+    int32_t maxRate;       // Units: per second
+    int32_t maxAccel;      // Units: per second squared
+    int32_t wrapRange;     // Range over which values wrap, or 0 for no wrap
+} trajectory_t;
+
+
+//*****************************************************************************
+// Initialises a trajectory with the given rate and acceleration limits
+// (in units per second and units per second squared), starting at rest at
+// zero. If wrapRange is non-zero, values are taken to wrap around in the
+// range -wrapRange / 2 to wrapRange / 2, e.g. 360 for an angle in degrees.
+//*****************************************************************************
+void initTrajectory(trajectory_t* traj, int16_t maxRate, int16_t maxAccel,
+                    int16_t wrapRange);
+
+//*****************************************************************************
+// Changes the rate and acceleration limits (in units per second and units
+// per second squared). If the reference is moving faster than the new rate
+// limit, it slows down at the acceleration limit rather than immediately.
+//*****************************************************************************
+void trajectorySetLimits(trajectory_t* traj, int16_t maxRate,
+                         int16_t maxAccel);
+
+//*****************************************************************************
+// Moves the reference and target to the given value immediately, at rest.
+//*****************************************************************************
+void trajectoryReset(trajectory_t* traj, int16_t position);
+
+//*****************************************************************************
+// Moves the reference and target by the given amount (in hundredths of a
+// unit) immediately, keeping the current velocity. Used when the frame of
+// reference changes, e.g. when a reference position is found.
+//*****************************************************************************
+void trajectoryShift(trajectory_t* traj, int32_t amount);
+
+//*****************************************************************************
+// Sets the value which the reference will move towards.
+//*****************************************************************************
+void trajectorySetTarget(trajectory_t* traj, int16_t target);
+
+//*****************************************************************************
+// Returns the value which the reference is moving towards.
+//*****************************************************************************
+int16_t trajectoryTarget(trajectory_t* traj);
+
+//*****************************************************************************
+// Advances the reference by one update period. Should be called at the given
+// update rate (in Hz), e.g. from the control update.
+//*****************************************************************************
+void trajectoryUpdate(trajectory_t* traj, uint16_t updateRate);
+
+//*****************************************************************************
+// Returns the current reference value, rounded to the nearest whole unit.
+//*****************************************************************************
+int16_t trajectoryPosition(trajectory_t* traj);
+
+//*****************************************************************************
+// Returns true if the reference has reached the target and is at rest.
+//*****************************************************************************
+bool trajectoryFinished(trajectory_t* traj);
+
+
+#endif  // TRAJECTORY_H_
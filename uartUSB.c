@@ -10,7 +10,7 @@
 //              written by P.J. Bones UCECE
 //
 // Support for transmission across a serial link using UART0
-// on the Tiva board.
+// on the Tiva board, and for receiving commands over it.
 //
 // Uses 9600 baud, 8-bit word length, 1 stop bit, no parity bit.
 //
@@ -23,12 +23,16 @@
 #include "driverlib/gpio.h"
 #include "driverlib/pin_map.h"
 #include "driverlib/uart.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/sysctl.h"
 #include "utils/ustdlib.h"
-#include "altitude.h"
-#include "yaw.h"
-#include "rotors.h"
 #include "flightState.h"
+#include "vehicleState.h"
+#include "control.h"
+#include "health.h"
+#include "clock.h"
+#include "board.h"
+#include "wcet.h"
 
 #include "uartUSB.h"
 
@@ -38,14 +42,17 @@
 //****************************************************************
 #define BAUD_RATE           9600
 
-// Uses UART0 module with Rx pin PA0 and Tx pin PA1.
-#define UART_BASE           UART0_BASE
-#define UART_PERIPH_UART    SYSCTL_PERIPH_UART0
-#define UART_PERIPH_GPIO    SYSCTL_PERIPH_GPIOA
-#define UART_GPIO_BASE      GPIO_PORTA_BASE
-#define UART_GPIO_PIN_RX    GPIO_PIN_0
-#define UART_GPIO_PIN_TX    GPIO_PIN_1
-#define UART_GPIO_PINS      UART_GPIO_PIN_RX | UART_GPIO_PIN_TX
+// The baud rate divisor has a resolution of 1/64, and is rounded by
+// UARTConfigSetExpClk. Check that the resulting baud rate is within
+// tolerance for the selected clock profile.
+#define BAUD_DIVISOR        (((CLOCK_RATE_HZ * 8) / BAUD_RATE + 1) / 2)
+#define BAUD_ACTUAL         ((CLOCK_RATE_HZ * 4) / BAUD_DIVISOR)
+#define BAUD_TOLERANCE      (BAUD_RATE / 100)
+
+#if BAUD_ACTUAL > BAUD_RATE + BAUD_TOLERANCE || \
+    BAUD_ACTUAL < BAUD_RATE - BAUD_TOLERANCE
+#error "Baud rate cannot be generated accurately from the system clock"
+#endif
 
 // Transmits with word length 8, one stop bit and no parity bits.
 #define UART_WORD_LEN       UART_CONFIG_WLEN_8
@@ -56,27 +63,222 @@
 // The number of characters to send over UART at a time.
 #define STR_LEN             18
 
+// Characters are queued in a transmit buffer, which the UART interrupt
+// drains into the hardware FIFO. Bulk output (the dumps after each flight)
+// is only queued while at least the reserve would remain free, so that it
+// never blocks the scheduler and always leaves room for the status.
+#define TX_BUFFER_SIZE      512
+#define TX_BULK_RESERVE     128
+
+// The longest command which can be received, excluding the line ending.
+#define COMMAND_LEN         40
+
+// Sets the altitude and yaw gains, in CONTROL_GAIN_SCALE units:
+// GAINS,<alt kp>,<alt ki>,<alt kd>,<yaw kp>,<yaw ki>,<yaw kd>
+// Only accepted while landed, as the integrators are reset.
+#define COMMAND_GAINS       "GAINS,"
+#define NUM_GAINS           6
+
+// Sets the main to tail coupling gain, in CONTROL_GAIN_SCALE units:
+// COUPLING,<gain>
+// Accepted in any flight state, as no controller state depends on it.
+#define COMMAND_COUPLING    "COUPLING,"
+
+
+//****************************************************************
+// Static variables
+//****************************************************************
+// The UART module and pins used.
+static const boardUart_t uart = BOARD_UART;
+
+// The transmit buffer. Characters are added at the head by the background
+// tasks and removed from the tail by the UART interrupt.
+static volatile char txBuffer[TX_BUFFER_SIZE];
+static volatile uint16_t txHead = 0;
+static volatile uint16_t txTail = 0;
+
+// The command line being received. Once a whole line has been received,
+// it is kept until handled by uartCheckCommands, and any further
+// characters are discarded. Lines which are too long are discarded.
+static volatile char commandLine[COMMAND_LEN + 1];
+static volatile uint16_t commandLength = 0;
+static volatile bool commandReady = false;
+static volatile bool commandOverflow = false;
+
+
+//****************************************************************
+// Static function forward declarations
+//****************************************************************
+static void uartIntHandler(void);
+static void uartFillFifo(void);
+static void uartReceive(void);
+static uint16_t uartTxFree(void);
+static void uartHandleCommand(const char* command);
+static bool parseValues(const char* string, int16_t* values,
+                        uint16_t numValues);
+
 
 //*****************************************************************************
 // Initialise the UART module, including the Rx and Tx pins used.
 //*****************************************************************************
 void initUart (void) {
-    // Enable the UART0 module and GPIO port A, which is used for UART0 pins.
-    SysCtlPeripheralEnable(UART_PERIPH_UART);
-    SysCtlPeripheralEnable(UART_PERIPH_GPIO);
+    // Enable the UART module and the GPIO port used for its pins.
+    SysCtlPeripheralEnable(uart.periph);
+    SysCtlPeripheralEnable(uart.rx.periph);
 
     // Configure the Rx and Tx pins for UART use.
-    GPIOPinTypeUART(UART_GPIO_BASE, UART_GPIO_PINS);
-    GPIOPinConfigure(GPIO_PA0_U0RX);
-    GPIOPinConfigure(GPIO_PA1_U0TX);
+    GPIOPinTypeUART(uart.rx.base, uart.rx.pin | uart.tx.pin);
+    GPIOPinConfigure(uart.rxConfig);
+    GPIOPinConfigure(uart.txConfig);
 
     // Configure the UART clock rate, baud rate, word length, stop bits
     // and parity bits
-    UARTConfigSetExpClk(UART_BASE, SysCtlClockGet(), BAUD_RATE, UART_CONFIG);
+    UARTConfigSetExpClk(uart.base, clockRate(), BAUD_RATE, UART_CONFIG);
 
     // Enable Tx and Rx buffers and the UART module itself.
-    UARTFIFOEnable(UART_BASE);
-    UARTEnable(UART_BASE);
+    UARTFIFOEnable(uart.base);
+    UARTEnable(uart.base);
+
+    // Interrupt when the transmit FIFO drains below its trigger level, to
+    // refill it from the transmit buffer, and when the receive FIFO fills
+    // past its trigger level or has held characters for a while, so that
+    // commands are not lost while the background tasks are busy.
+    UARTIntRegister(uart.base, uartIntHandler);
+    UARTIntEnable(uart.base, UART_INT_TX | UART_INT_RX | UART_INT_RT);
+}
+
+//*****************************************************************************
+// The UART interrupt handler. Refills the transmit FIFO and collects
+// received characters.
+//*****************************************************************************
+static void uartIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_UART);
+    uint32_t status = UARTIntStatus(uart.base, true);
+    UARTIntClear(uart.base, status);
+
+    if (status & UART_INT_TX) {
+        uartFillFifo();
+    }
+    if (status & (UART_INT_RX | UART_INT_RT)) {
+        uartReceive();
+    }
+    WCET_ISR_EXIT(WCET_ISR_UART);
+}
+
+//*****************************************************************************
+// Moves characters from the transmit buffer into the transmit FIFO until
+// either is full or empty. Called from the UART interrupt, or with the
+// transmit interrupt disabled.
+//*****************************************************************************
+static void uartFillFifo(void) {
+    while (txTail != txHead && UARTSpaceAvail(uart.base)) {
+        UARTCharPutNonBlocking(uart.base, txBuffer[txTail]);
+        txTail = (txTail + 1) % TX_BUFFER_SIZE;
+    }
+}
+
+//*****************************************************************************
+// Collects received characters into the command line, until a line ending
+// is received.
+//*****************************************************************************
+static void uartReceive(void) {
+    while (UARTCharsAvail(uart.base)) {
+        char c = (char) UARTCharGetNonBlocking(uart.base);
+        if (commandReady) {
+            continue;
+        }
+
+        if (c == '\r' || c == '\n') {
+            if (commandOverflow) {
+                commandOverflow = false;
+                commandLength = 0;
+            } else if (commandLength > 0) {
+                commandLine[commandLength] = '\0';
+                commandReady = true;
+            }
+        } else if (commandLength < COMMAND_LEN) {
+            commandLine[commandLength] = c;
+            commandLength++;
+        } else {
+            commandOverflow = true;
+        }
+    }
+}
+
+//*****************************************************************************
+// Handles the last command received, if any. Should be called regularly as
+// a background task.
+//*****************************************************************************
+void uartCheckCommands(void) {
+    if (!commandReady) {
+        return;
+    }
+
+    char command[COMMAND_LEN + 1];
+    uint16_t i = 0;
+    for (i = 0; i <= commandLength; i++) {
+        command[i] = commandLine[i];
+    }
+    commandLength = 0;
+    commandReady = false;
+
+    uartHandleCommand(command);
+}
+
+//*****************************************************************************
+// Carries out a command, replying with whether it was accepted.
+//*****************************************************************************
+static void uartHandleCommand(const char* command) {
+    uint16_t gainsLength = sizeof(COMMAND_GAINS) - 1;
+    uint16_t couplingLength = sizeof(COMMAND_COUPLING) - 1;
+    int16_t values[NUM_GAINS];
+
+    if (ustrncmp(command, COMMAND_GAINS, gainsLength) == 0
+            && parseValues(command + gainsLength, values, NUM_GAINS)
+            && getFlightState() == LANDED) {
+        controlGains_t altitudeGains = {values[0], values[1], values[2]};
+        controlGains_t yawGains = {values[3], values[4], values[5]};
+        controlSetGains(&altitudeGains, &yawGains);
+        uartSend("GAINS,OK\r\n");
+    } else if (ustrncmp(command, COMMAND_COUPLING, couplingLength) == 0
+            && parseValues(command + couplingLength, values, 1)) {
+        controlSetCoupling(values[0]);
+        uartSend("COUPLING,OK\r\n");
+    } else {
+        uartSend("CMD,ERR\r\n");
+    }
+}
+
+//*****************************************************************************
+// Parses the given number of comma separated, non-negative values, each of
+// which must fit in an int16_t.
+//
+// returns: false if the string is not in this form.
+//*****************************************************************************
+static bool parseValues(const char* string, int16_t* values,
+                        uint16_t numValues) {
+    uint16_t i = 0;
+    for (i = 0; i < numValues; i++) {
+        if (*string < '0' || *string > '9') {
+            return false;
+        }
+
+        const char* end;
+        unsigned long value = ustrtoul(string, &end, 10);
+        if (value > INT16_MAX) {
+            return false;
+        }
+        values[i] = (int16_t) value;
+        string = end;
+
+        if (i < numValues - 1) {
+            if (*string != ',') {
+                return false;
+            }
+            string++;
+        }
+    }
+    return *string == '\0';
 }
 
 //*****************************************************************************
@@ -84,33 +286,95 @@ void initUart (void) {
 //*****************************************************************************
 void uartSendStatus(void) {
     char line[STR_LEN + 1];
+    vehicleState_t state;
+    vehicleStateGet(&state);
 
     usnprintf(line, sizeof(line),
-              "Alt: %4d [%4d]\r\n", altitudePercent(), altitudeDesired());
+              "Alt: %4d [%4d]\r\n", state.altitude, state.desiredAltitude);
     uartSend(line);
 
     usnprintf(line, sizeof(line),
-              "Yaw: %4d [%4d]\r\n", yawDegrees(), yawDesired());
+              "Yaw: %4d [%4d]\r\n", state.yaw, state.desiredYaw);
     uartSend(line);
 
-    usnprintf(line, sizeof(line), "Main: %4d%%\r\n", getMainRotorPower());
+    usnprintf(line, sizeof(line), "Main: %4d%%\r\n", state.mainRotorPower);
     uartSend(line);
 
-    usnprintf(line, sizeof(line), "Tail: %4d%%\r\n", getTailRotorPower());
+    usnprintf(line, sizeof(line), "Tail: %4d%%\r\n", state.tailRotorPower);
     uartSend(line);
 
-    usnprintf(line, sizeof(line), "%16s\r\n", flightStateString());
+    usnprintf(line, sizeof(line), "Rate: %4d %4d\r\n",
+              state.altitudeRate / 100, state.yawRate / 100);
     uartSend(line);
+
+    usnprintf(line, sizeof(line), "FF: %4d %4d%%\r\n",
+              controlHoverDuty(), controlCouplingDuty());
+    uartSend(line);
+
+    usnprintf(line, sizeof(line), "%16s\r\n", flightStateString(state.flightState));
+    uartSend(line);
+
+    // Only faults which have been raised are sent, to keep the status short.
+    uint16_t fault = 0;
+    for (fault = 0; fault < NUM_FAULTS; fault++) {
+        uint16_t count = healthFaultCount((fault_t) fault);
+        if (count > 0) {
+            usnprintf(line, sizeof(line), "Fault %u: %5u%s\r\n", fault, count,
+                      (healthActiveFaults() & (1u << fault)) ? "*" : "");
+            uartSend(line);
+        }
+    }
 }
 
 //*****************************************************************************
 // Transmit the given string via UART.
-// Uses a blocking function for sending characters.
+// Queues the string for sending, blocking only while the transmit buffer
+// is full.
 //*****************************************************************************
 void uartSend(char *string) {
     while(*string) {
-        // Write the next character to the UART Tx buffer.
-        UARTCharPut(UART_BASE, *string);
+        // Wait for space, moving characters into the FIFO meanwhile in case
+        // interrupts are disabled.
+        while (uartTxFree() == 0) {
+            UARTIntDisable(uart.base, UART_INT_TX);
+            uartFillFifo();
+            UARTIntEnable(uart.base, UART_INT_TX);
+        }
+
+        // Add the next character to the transmit buffer.
+        txBuffer[txHead] = *string;
+        txHead = (txHead + 1) % TX_BUFFER_SIZE;
         string++;
     }
+
+    // The transmit interrupt only occurs as the FIFO drains, so start it
+    // off in case it is empty.
+    UARTIntDisable(uart.base, UART_INT_TX);
+    uartFillFifo();
+    UARTIntEnable(uart.base, UART_INT_TX);
+}
+
+//*****************************************************************************
+// Transmit the given string via UART, for bulk output which can wait. Only
+// queues the string if the transmit buffer has room for it while keeping
+// a reserve free for other output, so never blocks.
+//
+// returns: false if the string was not sent, and should be tried again
+//          later.
+//*****************************************************************************
+bool uartSendIfRoom(char *string) {
+    if (uartTxFree() < ustrlen(string) + TX_BULK_RESERVE) {
+        return false;
+    }
+    uartSend(string);
+    return true;
+}
+
+//*****************************************************************************
+// Returns the number of characters which can be added to the transmit
+// buffer.
+//*****************************************************************************
+static uint16_t uartTxFree(void) {
+    uint16_t used = (txHead + TX_BUFFER_SIZE - txTail) % TX_BUFFER_SIZE;
+    return TX_BUFFER_SIZE - 1 - used;
 }
@@ -10,9 +10,10 @@
 //              written by P.J. Bones UCECE
 //
 // Support for transmission across a serial link using UART0
-// on the Tiva board.
+// on the Tiva board, and for receiving commands over it.
 //
-// Uses 9600 baud, 8-bit word length, 1 stop bit, no parity bit.
+// Uses 9600 baud, 8-bit word length, 1 stop bit, no parity bit. Output is
+// queued in a buffer and sent from the UART interrupt.
 //
 // ****************************************************************************
 
@@ -25,6 +26,12 @@
 //*****************************************************************************
 void initUart(void);
 
+//*****************************************************************************
+// Handles the last command received, if any. Should be called regularly as
+// a background task.
+//*****************************************************************************
+void uartCheckCommands(void);
+
 //*****************************************************************************
 // Transmits a message containing information about the status of the program.
 //*****************************************************************************
@@ -32,9 +39,20 @@ void uartSendStatus(void);
 
 //*****************************************************************************
 // Transmit the given string via UART.
-// Uses a blocking function for sending characters.
+// Queues the string for sending, blocking only while the transmit buffer
+// is full.
 //*****************************************************************************
 void uartSend(char *string);
 
+//*****************************************************************************
+// Transmit the given string via UART, for bulk output which can wait. Only
+// queues the string if the transmit buffer has room for it while keeping
+// a reserve free for other output, so never blocks.
+//
+// returns: false if the string was not sent, and should be tried again
+//          later.
+//*****************************************************************************
+bool uartSendIfRoom(char *string);
+
 
 #endif /* UARTUSB_H_ */
@@ -0,0 +1,77 @@
+//*****************************************************************************
+//
+// File: vehicleState.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module providing a coherent, timestamped snapshot of the state of the
+// helicopter (sensor values, setpoints, rotor duties and flight state),
+// shared between interrupt handlers and tasks without disabling interrupts.
+//
+// The snapshot is published from a single interrupt handler (the altitude
+// ADC interrupt, at the sample rate) and protected by a sequence counter,
+// so readers retry if a new snapshot is published while they are copying.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "altitude.h"
+#include "yaw.h"
+#include "rotors.h"
+#include "estimator.h"
+
+#include "vehicleState.h"
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+
+// The latest snapshot, and a sequence counter which is odd while the
+// snapshot is being written.
+static volatile vehicleState_t snapshot;
+static volatile uint32_t sequence = 0;
+
+// Number of snapshots published, used as the timestamp.
+static uint32_t numPublished = 0;
+
+
+//*****************************************************************************
+// Captures the current state of the helicopter from each module and
+// publishes it as the latest snapshot. Must only be called from one
+// interrupt handler, which must not be preempted by any reader.
+//*****************************************************************************
+void vehicleStatePublish(void) {
+    sequence++;
+
+    snapshot.timestamp = numPublished++;
+    snapshot.meanADC = altitudeMeanADC();
+    snapshot.altitude = altitudePercent();
+    snapshot.altitudeRate = estimatorAltitudeRate();
+    snapshot.yawCount = yawCount();
+    snapshot.yaw = yawDegrees();
+    snapshot.yawRate = yawRateCentiDegrees();
+    snapshot.desiredAltitude = altitudeDesired();
+    snapshot.desiredYaw = yawDesired();
+    snapshot.mainRotorPower = getMainRotorPower();
+    snapshot.tailRotorPower = getTailRotorPower();
+    snapshot.flightState = getFlightState();
+
+    sequence++;
+}
+
+//*****************************************************************************
+// Copies the latest published snapshot into the given structure, retrying
+// if a new snapshot was published part way through the copy.
+//*****************************************************************************
+void vehicleStateGet(vehicleState_t* state) {
+    uint32_t startSequence;
+
+    do {
+        startSequence = sequence;
+        *state = snapshot;
+    } while ((startSequence & 1) || startSequence != sequence);
+}
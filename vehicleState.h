@@ -0,0 +1,57 @@
+//*****************************************************************************
+//
+// File: vehicleState.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module providing a coherent, timestamped snapshot of the state of the
+// helicopter (sensor values, setpoints, rotor duties and flight state),
+// shared between interrupt handlers and tasks without disabling interrupts.
+//
+// The snapshot is published from a single interrupt handler (the altitude
+// ADC interrupt, at the sample rate) and protected by a sequence counter,
+// so readers retry if a new snapshot is published while they are copying.
+//
+//*****************************************************************************
+
+#ifndef VEHICLE_STATE_H_
+#define VEHICLE_STATE_H_
+
+#include "flightState.h"
+
+
+//*****************************************************************************
+// Snapshot of the state of the helicopter.
+//*****************************************************************************
+typedef struct {
+    uint32_t timestamp;          // Units: altitude sample periods
+    int16_t meanADC;             // Raw mean ADC value
+    int16_t altitude;            // Units: %
+    int32_t altitudeRate;        // Units: 0.01% / s
+    int32_t yawCount;            // Raw quadrature count
+    int16_t yaw;                 // Units: deg, in the range -180 to 180
+    int32_t yawRate;             // Units: 0.01 deg / s
+    int16_t desiredAltitude;     // Units: %
+    int16_t desiredYaw;          // Units: deg
+    uint16_t mainRotorPower;     // Units: %
+    uint16_t tailRotorPower;     // Units: %
+    flightState_t flightState;
+} vehicleState_t;
+
+
+//*****************************************************************************
+// Captures the current state of the helicopter from each module and
+// publishes it as the latest snapshot. Must only be called from one
+// interrupt handler, which must not be preempted by any reader.
+//*****************************************************************************
+void vehicleStatePublish(void);
+
+//*****************************************************************************
+// Copies the latest published snapshot into the given structure.
+//*****************************************************************************
+void vehicleStateGet(vehicleState_t* state);
+
+
+#endif  // VEHICLE_STATE_H_
@@ -0,0 +1,172 @@
+//*****************************************************************************
+//
+// File: watchdog.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which configures the hardware watchdog to reset the processor if
+// it is not kicked within its timeout, e.g. because the control loop has
+// stopped running or a background task has hung.
+//
+// The most recently started background tasks are recorded in RAM which is
+// not initialised at startup, so that after a reset the cause of the reset
+// and the tasks running before it can be reported.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/watchdog.h"
+#include "utils/ustdlib.h"
+#include "clock.h"
+#include "uartUSB.h"
+
+#include "watchdog.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define WATCHDOG_PERIPH         SYSCTL_PERIPH_WDOG0
+#define WATCHDOG_BASE           WATCHDOG0_BASE
+
+// Number of tasks kept in the reset record. Must be a power of two.
+#define RECORD_TASKS            4
+
+// Marks the reset record as valid, as its contents are random after a
+// power-on reset.
+#define RECORD_MAGIC            0x52535452
+
+// Maximum length of a line sent over UART.
+#define LINE_LEN                80
+
+
+//*****************************************************************************
+// The record kept over a reset: the indices of the most recently started
+// tasks, and the total number started.
+//*****************************************************************************
+typedef struct {
+    uint32_t magic;
+    uint32_t numTasks;
+    uint8_t tasks[RECORD_TASKS];
+} resetRecord_t;
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+
+// Placed in a section which is not initialised at startup.
+#ifdef __TI_COMPILER_VERSION__
+#pragma NOINIT(resetRecord)
+static resetRecord_t resetRecord;
+#else
+static resetRecord_t resetRecord __attribute__((section(".noinit")));
+#endif
+
+// The cause of the last reset, and the tasks recorded before it, oldest
+// first.
+static uint32_t resetCause = 0;
+static uint8_t lastTasks[RECORD_TASKS];
+static uint16_t numLastTasks = 0;
+
+
+//*****************************************************************************
+// Reads and clears the cause of the last reset, and takes the tasks recorded
+// before it. Must be called at startup, before any task is recorded.
+//*****************************************************************************
+void watchdogCheckReset(void) {
+    resetCause = SysCtlResetCauseGet();
+    SysCtlResetCauseClear(resetCause);
+
+    // After a power-on reset the record is not valid, and is only cleared.
+    if (resetRecord.magic == RECORD_MAGIC && !(resetCause & SYSCTL_CAUSE_POR)) {
+        uint32_t first = 0;
+        if (resetRecord.numTasks > RECORD_TASKS) {
+            first = resetRecord.numTasks - RECORD_TASKS;
+        }
+
+        uint32_t i = 0;
+        for (i = first; i < resetRecord.numTasks; i++) {
+            lastTasks[numLastTasks] = resetRecord.tasks[i & (RECORD_TASKS - 1)];
+            numLastTasks++;
+        }
+    }
+
+    resetRecord.magic = RECORD_MAGIC;
+    resetRecord.numTasks = 0;
+}
+
+//*****************************************************************************
+// Sends the cause of the last reset and the tasks recorded before it over
+// UART, as a "RESET,cause,task,..." line, oldest task first.
+//*****************************************************************************
+void watchdogReportReset(void) {
+    char line[LINE_LEN + 1];
+    int32_t length = 0;
+
+    length += usnprintf(line, sizeof(line), "RESET,%s",
+                        (resetCause & SYSCTL_CAUSE_WDOG0) ? "WATCHDOG"
+                        : (resetCause & SYSCTL_CAUSE_POR) ? "POWER_ON"
+                        : (resetCause & SYSCTL_CAUSE_BOR) ? "BROWN_OUT"
+                        : (resetCause & SYSCTL_CAUSE_SW) ? "SOFTWARE"
+                        : (resetCause & SYSCTL_CAUSE_EXT) ? "EXTERNAL"
+                        : "OTHER");
+
+    uint16_t i = 0;
+    for (i = 0; i < numLastTasks; i++) {
+        length += usnprintf(&line[length], sizeof(line) - length, ",%u",
+                            lastTasks[i]);
+    }
+
+    usnprintf(&line[length], sizeof(line) - length, "\r\n");
+    uartSend(line);
+}
+
+//*****************************************************************************
+// Records that the background task with the given index has started.
+//*****************************************************************************
+void watchdogRecordTask(uint8_t taskIndex) {
+    resetRecord.tasks[resetRecord.numTasks & (RECORD_TASKS - 1)] = taskIndex;
+    resetRecord.numTasks++;
+}
+
+//*****************************************************************************
+// Starts the watchdog, which resets the processor if watchdogKick is not
+// called for the given time (in ms). The watchdog is stalled while the
+// processor is halted by the debugger.
+//*****************************************************************************
+void initWatchdog(uint16_t timeoutMs) {
+    SysCtlPeripheralEnable(WATCHDOG_PERIPH);
+    while (!SysCtlPeripheralReady(WATCHDOG_PERIPH)) {
+        continue;
+    }
+
+    // The watchdog raises its interrupt on the first timeout and resets the
+    // processor on the second, if the interrupt has not been cleared, so it
+    // is loaded with half of the timeout.
+    WatchdogReloadSet(WATCHDOG_BASE,
+                      (uint64_t) clockRate() * timeoutMs / 2000);
+    WatchdogResetEnable(WATCHDOG_BASE);
+    WatchdogStallEnable(WATCHDOG_BASE);
+    WatchdogEnable(WATCHDOG_BASE);
+
+    // Prevent the configuration being changed by accident.
+    WatchdogLock(WATCHDOG_BASE);
+}
+
+//*****************************************************************************
+// Restarts the watchdog timeout.
+//*****************************************************************************
+void watchdogKick(void) {
+    // Clearing the interrupt reloads the counter, but writes to the
+    // interrupt clear register are ignored while the watchdog is locked, so
+    // it is unlocked for the clear and locked again afterwards.
+    WatchdogUnlock(WATCHDOG_BASE);
+    WatchdogIntClear(WATCHDOG_BASE);
+    WatchdogLock(WATCHDOG_BASE);
+}
@@ -0,0 +1,53 @@
+//*****************************************************************************
+//
+// File: watchdog.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module which configures the hardware watchdog to reset the processor if
+// it is not kicked within its timeout, e.g. because the control loop has
+// stopped running or a background task has hung.
+//
+// The most recently started background tasks are recorded in RAM which is
+// not initialised at startup, so that after a reset the cause of the reset
+// and the tasks running before it can be reported.
+//
+//*****************************************************************************
+
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+
+//*****************************************************************************
+// Reads and clears the cause of the last reset, and takes the tasks recorded
+// before it. Must be called at startup, before any task is recorded.
+//*****************************************************************************
+void watchdogCheckReset(void);
+
+//*****************************************************************************
+// Sends the cause of the last reset and the tasks recorded before it over
+// UART, as a "RESET,cause,task,..." line, oldest task first.
+//*****************************************************************************
+void watchdogReportReset(void);
+
+//*****************************************************************************
+// Records that the background task with the given index has started.
+//*****************************************************************************
+void watchdogRecordTask(uint8_t taskIndex);
+
+//*****************************************************************************
+// Starts the watchdog, which resets the processor if watchdogKick is not
+// called for the given time (in ms). The watchdog is stalled while the
+// processor is halted by the debugger.
+//*****************************************************************************
+void initWatchdog(uint16_t timeoutMs);
+
+//*****************************************************************************
+// Restarts the watchdog timeout.
+//*****************************************************************************
+void watchdogKick(void);
+
+
+#endif  // WATCHDOG_H_
@@ -0,0 +1,235 @@
+//*****************************************************************************
+//
+// File: wcet.c
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module for measuring the worst-case execution time of each interrupt
+// handler and scheduler task, and checking that the configured task set is
+// schedulable. From the measured maxima, computes the total CPU utilisation
+// and the worst-case response time of each task for the current priority
+// ordering, and reports these over UART, with a warning if the utilisation
+// exceeds 100% or a task could miss its period.
+//
+// Measurement is only compiled in when WCET_ENABLED is defined, otherwise
+// the macros in wcet.h are empty and wcetReport does nothing.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/ustdlib.h"
+#include "clock.h"
+#include "uartUSB.h"
+#include "scheduler.h"
+
+#include "wcet.h"
+
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+
+// Utilisation is reported in tenths of a percent.
+#define UTILISATION_SCALE       1000
+
+// Maximum length of a line sent over UART.
+#define LINE_LEN                80
+
+
+//*****************************************************************************
+// Timing of one interrupt handler. The period is the shortest time between
+// two runs of the handler.
+//*****************************************************************************
+typedef struct {
+    const char* name;
+    uint32_t periodCycles;
+    uint32_t maxCycles;
+} isrTiming_t;
+
+
+//*****************************************************************************
+// Static variables
+//*****************************************************************************
+// The periods are set by wcetSetIsrRate during initialisation.
+static volatile isrTiming_t isrs[NUM_WCET_ISRS] = {
+    [WCET_ISR_SYSTICK]        = {.name = "SysTick",       .periodCycles = 0},
+    [WCET_ISR_ADC]            = {.name = "ADC",           .periodCycles = 0},
+    [WCET_ISR_YAW_EDGE]       = {.name = "YawEdge",       .periodCycles = 0},
+    [WCET_ISR_YAW_REFERENCE]  = {.name = "YawReference",  .periodCycles = 0},
+    [WCET_ISR_CONTROL]        = {.name = "Control",       .periodCycles = 0},
+    [WCET_ISR_INPUT_EDGE]     = {.name = "InputEdge",     .periodCycles = 0},
+    [WCET_ISR_INPUT_DEBOUNCE] = {.name = "InputDebounce", .periodCycles = 0},
+    [WCET_ISR_BUTTON_HOLD]    = {.name = "ButtonHold",    .periodCycles = 0},
+    [WCET_ISR_UART]           = {.name = "Uart",          .periodCycles = 0}
+};
+
+static uint32_t tickCycles;
+
+// The next line to report: interrupt handlers first, then tasks, then the
+// summary. Whether a task has been found which could miss its period.
+static uint16_t reportIndex = 0;
+static bool deadlineMissed = false;
+
+
+//*****************************************************************************
+// Static function forward declarations
+//*****************************************************************************
+static uint32_t utilisation(uint32_t maxCycles, uint32_t periodCycles);
+static uint32_t responseTime(uint16_t taskIndex);
+static uint32_t interference(uint32_t window, uint32_t maxCycles,
+                             uint32_t periodCycles);
+
+
+//*****************************************************************************
+// Enables the cycle counter, and stores the scheduler tick rate, from which
+// the task periods are found.
+//*****************************************************************************
+void initWcet(uint32_t tickRateHz) {
+#ifdef WCET_ENABLED
+    initCycleCounter();
+#endif
+    tickCycles = clockRate() / tickRateHz;
+}
+
+//*****************************************************************************
+// Sets the maximum rate at which the given interrupt handler can run, used
+// as its period in the analysis.
+//*****************************************************************************
+void wcetSetIsrRate(wcetIsrId_t id, uint32_t rateHz) {
+    isrs[id].periodCycles = clockRate() / rateHz;
+}
+
+//*****************************************************************************
+// Records one execution time of the given interrupt handler, in cycles.
+//*****************************************************************************
+void wcetIsrRecord(wcetIsrId_t id, uint32_t cycles) {
+    if (cycles > isrs[id].maxCycles) {
+        isrs[id].maxCycles = cycles;
+    }
+}
+
+//*****************************************************************************
+// Sends the results for the next interrupt handler or task over UART,
+// cycling through all of them, followed by a summary line with the total
+// utilisation and whether the task set is schedulable. Should be called
+// regularly as a background task.
+//*****************************************************************************
+void wcetReport(void) {
+#ifdef WCET_ENABLED
+    char line[LINE_LEN + 1];
+    uint16_t numTasks = schedulerNumTasks();
+
+    if (reportIndex < NUM_WCET_ISRS) {
+        volatile isrTiming_t* isr = &isrs[reportIndex];
+        usnprintf(line, sizeof(line), "WCET,isr,%s,%u,%u,%u\r\n", isr->name,
+                  isr->periodCycles, isr->maxCycles,
+                  utilisation(isr->maxCycles, isr->periodCycles));
+        uartSend(line);
+        reportIndex++;
+
+    } else if (reportIndex < NUM_WCET_ISRS + numTasks) {
+        uint16_t taskIndex = reportIndex - NUM_WCET_ISRS;
+        uint32_t periodCycles = schedulerTaskTicksPerRun(taskIndex)
+                                * tickCycles;
+        uint32_t maxCycles = schedulerTaskMaxCycles(taskIndex);
+        uint32_t response = responseTime(taskIndex);
+        bool schedulable = response <= periodCycles;
+        deadlineMissed = deadlineMissed || !schedulable;
+
+        usnprintf(line, sizeof(line), "WCET,task,%u,%u,%u,%u,%u,%s\r\n",
+                  taskIndex, periodCycles, maxCycles,
+                  utilisation(maxCycles, periodCycles), response,
+                  schedulable ? "OK" : "MISS");
+        uartSend(line);
+        reportIndex++;
+
+    } else {
+        uint32_t total = 0;
+        uint16_t i = 0;
+        for (i = 0; i < NUM_WCET_ISRS; i++) {
+            total += utilisation(isrs[i].maxCycles, isrs[i].periodCycles);
+        }
+        for (i = 0; i < numTasks; i++) {
+            total += utilisation(schedulerTaskMaxCycles(i),
+                                 schedulerTaskTicksPerRun(i) * tickCycles);
+        }
+
+        bool warn = total > UTILISATION_SCALE || deadlineMissed;
+        usnprintf(line, sizeof(line), "WCET,total,%u.%u%%,%s\r\n",
+                  total / 10, total % 10, warn ? "WARN" : "OK");
+        uartSend(line);
+        reportIndex = 0;
+        deadlineMissed = false;
+    }
+#endif
+}
+
+//*****************************************************************************
+// Returns the fraction of the CPU used by something which takes at most
+// maxCycles to run, once every periodCycles, in tenths of a percent.
+//*****************************************************************************
+static uint32_t utilisation(uint32_t maxCycles, uint32_t periodCycles) {
+    if (periodCycles == 0) {
+        return 0;
+    }
+    return (uint64_t) maxCycles * UTILISATION_SCALE / periodCycles;
+}
+
+//*****************************************************************************
+// Returns the worst-case response time of the given task, in cycles, from
+// becoming ready to finishing. Tasks are not pre-empted by each other, so
+// the task can be blocked by the longest lower priority task which has
+// just started, then delayed by every release of a higher priority task
+// and every interrupt within the response time. Stops once the response
+// time exceeds the task's period, as the task is then not schedulable.
+// The measured task times include any interrupts which ran during them,
+// so the result is pessimistic.
+//*****************************************************************************
+static uint32_t responseTime(uint16_t taskIndex) {
+    uint16_t numTasks = schedulerNumTasks();
+    uint32_t periodCycles = schedulerTaskTicksPerRun(taskIndex) * tickCycles;
+    uint32_t blocking = 0;
+    uint16_t i = 0;
+
+    for (i = taskIndex + 1; i < numTasks; i++) {
+        if (schedulerTaskMaxCycles(i) > blocking) {
+            blocking = schedulerTaskMaxCycles(i);
+        }
+    }
+
+    uint32_t base = blocking + schedulerTaskMaxCycles(taskIndex);
+    uint32_t response = base;
+    uint32_t previous = 0;
+
+    while (response != previous && response <= periodCycles) {
+        previous = response;
+        response = base;
+        for (i = 0; i < taskIndex; i++) {
+            response += interference(previous, schedulerTaskMaxCycles(i),
+                                     schedulerTaskTicksPerRun(i)
+                                     * tickCycles);
+        }
+        for (i = 0; i < NUM_WCET_ISRS; i++) {
+            response += interference(previous, isrs[i].maxCycles,
+                                     isrs[i].periodCycles);
+        }
+    }
+
+    return response;
+}
+
+//*****************************************************************************
+// Returns the longest time within a window of the given length which can be
+// taken by something which takes at most maxCycles to run, once every
+// periodCycles.
+//*****************************************************************************
+static uint32_t interference(uint32_t window, uint32_t maxCycles,
+                             uint32_t periodCycles) {
+    if (periodCycles == 0) {
+        return 0;
+    }
+    return ((window + periodCycles - 1) / periodCycles) * maxCycles;
+}
@@ -0,0 +1,85 @@
+//*****************************************************************************
+//
+// File: wcet.h
+//
+// Authors: Reka Norman (rkn24)
+//          Matthew Toohey (mct63)
+//          James Brazier (jbr185)
+//
+// Module for measuring the worst-case execution time of each interrupt
+// handler and scheduler task, and checking that the configured task set is
+// schedulable. From the measured maxima, computes the total CPU utilisation
+// and the worst-case response time of each task for the current priority
+// ordering, and reports these over UART, with a warning if the utilisation
+// exceeds 100% or a task could miss its period.
+//
+// Measurement is only compiled in when WCET_ENABLED is defined, otherwise
+// the macros below are empty and wcetReport does nothing.
+//
+//*****************************************************************************
+
+#ifndef WCET_H_
+#define WCET_H_
+
+#include "cycleCounter.h"
+
+
+// The interrupt handlers which are measured.
+enum wcetIsrIds {WCET_ISR_SYSTICK = 0,
+                 WCET_ISR_ADC,
+                 WCET_ISR_YAW_EDGE,
+                 WCET_ISR_YAW_REFERENCE,
+                 WCET_ISR_CONTROL,
+                 WCET_ISR_INPUT_EDGE,      // Button and switch edges
+                 WCET_ISR_INPUT_DEBOUNCE,  // Button and switch debounce
+                 WCET_ISR_BUTTON_HOLD,     // Button hold timer
+                 WCET_ISR_UART,            // Transmit and receive
+                 NUM_WCET_ISRS};
+
+typedef enum wcetIsrIds wcetIsrId_t;
+
+
+#ifdef WCET_ENABLED
+
+// Start and stop measuring the given interrupt handler. Should enclose the
+// whole body of the handler.
+#define WCET_ISR_ENTER(id) \
+    uint32_t wcetStart_##id = CYCLE_COUNTER
+#define WCET_ISR_EXIT(id) \
+    wcetIsrRecord(id, CYCLE_COUNTER - wcetStart_##id)
+
+#else
+
+#define WCET_ISR_ENTER(id)
+#define WCET_ISR_EXIT(id)
+
+#endif
+
+
+//*****************************************************************************
+// Enables the cycle counter, and stores the scheduler tick rate, from which
+// the task periods are found.
+//*****************************************************************************
+void initWcet(uint32_t tickRateHz);
+
+//*****************************************************************************
+// Sets the maximum rate at which the given interrupt handler can run, used
+// as its period in the analysis.
+//*****************************************************************************
+void wcetSetIsrRate(wcetIsrId_t id, uint32_t rateHz);
+
+//*****************************************************************************
+// Records one execution time of the given interrupt handler, in cycles.
+//*****************************************************************************
+void wcetIsrRecord(wcetIsrId_t id, uint32_t cycles);
+
+//*****************************************************************************
+// Sends the results for the next interrupt handler or task over UART,
+// cycling through all of them, followed by a summary line with the total
+// utilisation and whether the task set is schedulable. Should be called
+// regularly as a background task.
+//*****************************************************************************
+void wcetReport(void);
+
+
+#endif  // WCET_H_
@@ -15,7 +15,16 @@
 #include "inc/hw_memmap.h"
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/interrupt.h"
+#include "trajectory.h"
+#include "vehicleState.h"
+#include "inputCapture.h"
+#include "benchmark.h"
+#include "wcet.h"
+#include "clock.h"
 #include "flightState.h"
+#include "board.h"
 
 #include "yaw.h"
 
@@ -24,31 +33,85 @@
 // Constants
 //*****************************************************************************
 
-// Yaw channels A and B use pins PB0 and PB1.
-#define YAW_GPIO_PERIPH             SYSCTL_PERIPH_GPIOB
-#define YAW_GPIO_BASE               GPIO_PORTB_BASE
-#define YAW_CHANNEL_A_PIN           GPIO_PIN_0
-#define YAW_CHANNEL_B_PIN           GPIO_PIN_1
-
-// Yaw reference signal uses pin PC4.
-#define YAW_REFERENCE_GPIO_PERIPH   SYSCTL_PERIPH_GPIOC
-#define YAW_REFERENCE_GPIO_BASE     GPIO_PORTC_BASE
-#define YAW_REFERENCE_PIN           GPIO_PIN_4
+// A free-running timer, counting up at the system clock rate, is used to
+// timestamp the edges on channels A and B.
+#define YAW_TIMER_PERIPH            SYSCTL_PERIPH_TIMER1
+#define YAW_TIMER_BASE              TIMER1_BASE
+#define YAW_TIMER                   TIMER_A
 
 #define SLOTS_IN_CIRCLE             112
 #define DEGREES_IN_CIRCLE           360
 #define YAW_CHANGE_PER_SLOT         4
+#define CENTIDEGREES_IN_CIRCLE      (DEGREES_IN_CIRCLE * 100)
+#define YAW_CHANGES_IN_CIRCLE       (SLOTS_IN_CIRCLE * YAW_CHANGE_PER_SLOT)
+
+// If no edge has occurred for this long, the helicopter is taken to be
+// stationary, in the middle of the current yaw count. Units: 1/s
+#define YAW_RATE_TIMEOUT_DIVISOR    10
+
+// Limits on the rate and acceleration of the reference yaw.
+#define MAX_YAW_RATE                60    // Units: deg per second
+#define MAX_YAW_ACCEL               120   // Units: deg per second squared
+
+// While searching for the yaw reference, the desired yaw is kept this far
+// ahead of the reference yaw, so that the reference sweeps round
+// continuously at the rate limit. Must be less than half a circle.
+// Units: deg
+#define YAW_SEARCH_LEAD             90
+
+// Default band around zero which the yaw must stay within, and for how
+// long, for the yaw part of a landing to be complete. Units: deg, ms
+#define LANDING_TOLERANCE           2
+#define LANDING_DWELL_MS            250
 
 
 //*****************************************************************************
 // Static variables
 //*****************************************************************************
 
+// The pins used for yaw channels A and B, and for the yaw reference signal.
+static const boardPin_t channelA = BOARD_YAW_CHANNEL_A;
+static const boardPin_t channelB = BOARD_YAW_CHANNEL_B;
+static const boardPin_t referencePin = BOARD_YAW_REFERENCE;
+
 // Yaw value relative to reference. Each slot corresponds to a yaw change of 4.
-static int16_t yawChange = 0;
+static volatile int32_t yawChange = 0;
+
+// Timestamp of the last edge, the direction of the yaw change it caused,
+// and the time since the previous edge in the same direction (or 0 if the
+// direction changed). Units: timer ticks.
+static volatile uint32_t lastEdgeTime = 0;
+static volatile int8_t lastEdgeStep = 0;
+static volatile uint32_t lastEdgeInterval = 0;
+
+// Incremented on every edge, so that the values above can be read
+// consistently from lower priority code.
+static volatile uint32_t edgeSequence = 0;
+
+// The yaw count at the edge where the reference signal was found, which is
+// subtracted from the yaw once the flight state machine handles it.
+static volatile int32_t referenceCount = 0;
+
+// Rate of the yaw timer in Hz, which is the system clock rate.
+static uint32_t yawTimerRate;
+
+// Whether each yaw channel was HIGH the last time an edge was processed.
+static bool previousChannelA = false;
+static bool previousChannelB = false;
 
-// The desired yaw value in degrees, in the range -180 to 180 degrees.
-static int16_t desiredYaw = 0;
+// Trajectory of the reference yaw in degrees, which moves smoothly towards
+// the desired yaw (the trajectory's target). Both are in the range -180 to
+// 180 degrees.
+static trajectory_t yawTrajectory;
+
+// Rate at which the reference is updated, in Hz.
+static uint16_t referenceUpdateRate = 1;
+
+// Landing completion band and dwell time, and the number of consecutive
+// updates for which the yaw has been within the band.
+static uint16_t landingTolerance = LANDING_TOLERANCE;
+static uint16_t landingDwellMs = LANDING_DWELL_MS;
+static uint32_t landingDwellUpdates = 0;
 
 
 //*****************************************************************************
@@ -56,7 +119,8 @@ static int16_t desiredYaw = 0;
 //*****************************************************************************
 static void yawChannelIntHandler(void);
 static void yawReferenceIntHandler(void);
-static int16_t convertYawToRange(int16_t yaw);
+static void yawReadEdge(int32_t* change, uint32_t* elapsed, int8_t* step,
+                        uint32_t* interval);
 
 
 //*****************************************************************************
@@ -64,105 +128,179 @@ static int16_t convertYawToRange(int16_t yaw);
 // measuring the yaw.
 //*****************************************************************************
 void initYaw(void) {
+    initTrajectory(&yawTrajectory, MAX_YAW_RATE, MAX_YAW_ACCEL,
+                   DEGREES_IN_CIRCLE);
+
+    // Configure the free-running timer used to timestamp the edges.
+    SysCtlPeripheralEnable(YAW_TIMER_PERIPH);
+    TimerConfigure(YAW_TIMER_BASE, TIMER_CFG_PERIODIC_UP);
+    TimerLoadSet(YAW_TIMER_BASE, YAW_TIMER, UINT32_MAX);
+    TimerEnable(YAW_TIMER_BASE, YAW_TIMER);
+    yawTimerRate = clockRate();
+
     // Configure the GPIO pins used for measuring the two yaw channels.
-    SysCtlPeripheralEnable(YAW_GPIO_PERIPH);
-    GPIOPinTypeGPIOInput(YAW_GPIO_BASE, YAW_CHANNEL_A_PIN | YAW_CHANNEL_B_PIN);
+    SysCtlPeripheralEnable(channelA.periph);
+    GPIOPinTypeGPIOInput(channelA.base, channelA.pin | channelB.pin);
 
     // Configure a pin change interrupt to be triggered by both rising and
     // falling edges on channels A and B, and enable the interrupt.
-    GPIOIntRegister(YAW_GPIO_BASE, yawChannelIntHandler);
-    GPIOIntTypeSet(YAW_GPIO_BASE,
-                   YAW_CHANNEL_A_PIN | YAW_CHANNEL_B_PIN,
+    GPIOIntRegister(channelA.base, yawChannelIntHandler);
+    GPIOIntTypeSet(channelA.base, channelA.pin | channelB.pin,
                    GPIO_BOTH_EDGES);
-    GPIOIntEnable(YAW_GPIO_BASE, YAW_CHANNEL_A_PIN | YAW_CHANNEL_B_PIN);
+    GPIOIntEnable(channelA.base, channelA.pin | channelB.pin);
 
     // Configure the GPIO pin used to read the yaw reference signal.
-    SysCtlPeripheralEnable(YAW_REFERENCE_GPIO_PERIPH);
-    GPIOPinTypeGPIOInput(YAW_REFERENCE_GPIO_BASE, YAW_REFERENCE_PIN);
-    GPIOPadConfigSet(YAW_REFERENCE_GPIO_BASE, YAW_REFERENCE_PIN,
+    SysCtlPeripheralEnable(referencePin.periph);
+    GPIOPinTypeGPIOInput(referencePin.base, referencePin.pin);
+    GPIOPadConfigSet(referencePin.base, referencePin.pin,
                      GPIO_STRENGTH_2MA, GPIO_PIN_TYPE_STD_WPU);
 
     // Configure a pin change interrupt to be triggered by falling edges
     // in the yaw reference signal, since it is active low.
-    GPIOIntRegister(YAW_REFERENCE_GPIO_BASE, yawReferenceIntHandler);
-    GPIOIntTypeSet(YAW_REFERENCE_GPIO_BASE, YAW_REFERENCE_PIN, GPIO_FALLING_EDGE);
-    GPIOIntEnable(YAW_REFERENCE_GPIO_BASE, YAW_REFERENCE_PIN);
+    GPIOIntRegister(referencePin.base, yawReferenceIntHandler);
+    GPIOIntTypeSet(referencePin.base, referencePin.pin, GPIO_FALLING_EDGE);
+    GPIOIntEnable(referencePin.base, referencePin.pin);
 }
 
 //*****************************************************************************
 // The pin change interrupt handler for the pins used to measure yaw
-// channels A and B. Compares the current values of the two input yaw
-// channels to their previous values to determine the direction of rotation
-// and updates the yaw value as needed.
+// channels A and B. Timestamps the edge and reads the two channels.
 //*****************************************************************************
 static void yawChannelIntHandler(void) {
-    // Variables to keep track of whether each yaw channel was HIGH the last
-    // time this interrupt occurred.
-    static bool previousChannelA = false;
-    static bool previousChannelB = false;
+    WCET_ISR_ENTER(WCET_ISR_YAW_EDGE);
+    uint32_t now = TimerValueGet(YAW_TIMER_BASE, YAW_TIMER);
+
+    // Check whether each yaw channel is currently HIGH, reading both
+    // channels at once.
+    uint32_t pins = GPIOPinRead(channelA.base, channelA.pin | channelB.pin);
+    bool currentChannelA = (pins & channelA.pin) != 0;
+    bool currentChannelB = (pins & channelB.pin) != 0;
+
+    BENCHMARK_START(BENCH_YAW_EDGE);
+    yawProcessChannels(currentChannelA, currentChannelB, now);
+    BENCHMARK_STOP(BENCH_YAW_EDGE);
+
+    GPIOIntClear(channelA.base, channelA.pin | channelB.pin);
+    WCET_ISR_EXIT(WCET_ISR_YAW_EDGE);
+}
+
+//*****************************************************************************
+// Processes an edge on yaw channel A or B. Compares the current values of
+// the two input yaw channels to their previous values to determine the
+// direction of rotation and updates the yaw value as needed. Each edge is
+// timestamped, so that the yaw can be interpolated between edges and the
+// yaw rate estimated. Called from the yaw channel interrupt handler, or when
+// replaying captured edges.
+//*****************************************************************************
+void yawProcessChannels(bool currentChannelA, bool currentChannelB,
+                        uint32_t now) {
+    int8_t step = 0;
 
-    // Check whether each yaw channel is currently HIGH.
-    bool currentChannelA = GPIOPinRead(YAW_GPIO_BASE, YAW_CHANNEL_A_PIN)
-                           == YAW_CHANNEL_A_PIN;
-    bool currentChannelB = GPIOPinRead(YAW_GPIO_BASE, YAW_CHANNEL_B_PIN)
-                           == YAW_CHANNEL_B_PIN;
+    inputCaptureRecordAt(CAPTURE_YAW, currentChannelA | (currentChannelB << 1),
+                         now);
 
     // Uses the previous and current values of channel A and channel B to
     // determine the direction of rotation, and update the yaw value as needed.
     if (!previousChannelA &&  !previousChannelB) {
         if (!currentChannelA && currentChannelB) {
-            yawChange += 1;
+            step = 1;
         } else if (currentChannelA && !currentChannelB) {
-            yawChange -= 1;
+            step = -1;
         }
     } else if (!previousChannelA && previousChannelB) {
         if (currentChannelA && currentChannelB) {
-            yawChange += 1;
+            step = 1;
         } else if (!currentChannelA && !currentChannelB) {
-            yawChange -= 1;
+            step = -1;
         }
     } else if (previousChannelA && !previousChannelB) {
         if (!currentChannelA && !currentChannelB) {
-            yawChange += 1;
+            step = 1;
         } else if (currentChannelA && currentChannelB) {
-            yawChange -= 1;
+            step = -1;
         }
     } else {
         if (currentChannelA && !currentChannelB) {
-            yawChange += 1;
+            step = 1;
         } else if (!currentChannelA && currentChannelB) {
-            yawChange -= 1;
+            step = -1;
         }
     }
 
+    if (step != 0) {
+        if (step == lastEdgeStep) {
+            lastEdgeInterval = now - lastEdgeTime;
+        } else {
+            lastEdgeInterval = 0;
+        }
+        lastEdgeStep = step;
+        lastEdgeTime = now;
+        yawChange += step;
+        edgeSequence++;
+    }
+
     previousChannelA = currentChannelA;
     previousChannelB = currentChannelB;
-
-    GPIOIntClear(YAW_GPIO_BASE, YAW_CHANNEL_A_PIN | YAW_CHANNEL_B_PIN);
 }
 
 //*****************************************************************************
-// The pin change interrupt handler for the yaw reference pin. If the
-// helicopter is currently taking off, and therefore trying to find the yaw
-// reference point, the interrupt handler will reset the current yaw value
-// to zero and update the helicopter's flight state.
-// Otherwise the interrupt is ignored.
+// The pin change interrupt handler for the yaw reference pin.
 //*****************************************************************************
 static void yawReferenceIntHandler(void) {
+    WCET_ISR_ENTER(WCET_ISR_YAW_REFERENCE);
+    yawProcessReference();
+    GPIOIntClear(referencePin.base, referencePin.pin);
+    WCET_ISR_EXIT(WCET_ISR_YAW_REFERENCE);
+}
+
+//*****************************************************************************
+// Processes the yaw reference signal. If the helicopter is currently taking
+// off, and therefore trying to find the yaw reference point, latches the
+// yaw count at this edge and notifies the flight state machine, which then
+// calls yawReconcileReference. Otherwise the signal is ignored. Called from
+// the yaw reference interrupt handler, or when replaying captured inputs.
+//*****************************************************************************
+void yawProcessReference(void) {
+    inputCaptureRecord(CAPTURE_YAW_REFERENCE, 0);
+
     if (getFlightState() == FINDING_YAW_REFERENCE) {
-        yawChange = 0;
-        desiredYaw = 0;
-        setFlightState(FLYING);
+        referenceCount = yawChange;
+        flightStatePostEvent(FLIGHT_EVENT_YAW_REFERENCE);
     }
+}
 
-    GPIOIntClear(YAW_REFERENCE_GPIO_BASE, YAW_REFERENCE_PIN);
+//*****************************************************************************
+// Makes the reference position found by yawProcessReference the zero yaw.
+// The yaw count and the reference yaw are both moved by
+// the yaw at the reference edge, so the reference yaw keeps its velocity
+// and the yaw error is unchanged, then the desired yaw is set to zero.
+// The vehicle state is published again, so that the snapshot used by the
+// controller is in the new frame.
+//*****************************************************************************
+void yawReconcileReference(void) {
+    // Interrupts are disabled so that no edge or vehicle state update can
+    // occur part way through.
+    bool interruptsDisabled = IntMasterDisable();
+
+    int32_t offset = referenceCount;
+    int32_t offsetCentiDegrees = (int64_t) offset * CENTIDEGREES_IN_CIRCLE
+                                 / YAW_CHANGES_IN_CIRCLE;
+    yawChange -= offset;
+    edgeSequence++;
+    trajectoryShift(&yawTrajectory, -offsetCentiDegrees);
+    trajectorySetTarget(&yawTrajectory, 0);
+    vehicleStatePublish();
+
+    if (!interruptsDisabled) {
+        IntMasterEnable();
+    }
 }
 
 //*****************************************************************************
 // Takes an arbitrary yaw value in degrees, and converts it to an equivalent
 // value in the range of -180 to 180 degrees.
 //*****************************************************************************
-static int16_t convertYawToRange(int16_t yaw) {
+int16_t convertYawToRange(int16_t yaw) {
     yaw %= DEGREES_IN_CIRCLE;
     if (yaw < -DEGREES_IN_CIRCLE / 2) {
         yaw += DEGREES_IN_CIRCLE;
@@ -177,57 +315,200 @@ static int16_t convertYawToRange(int16_t yaw) {
 // The yaw will be in the range of -180 to 180 degrees.
 //*****************************************************************************
 int16_t yawDegrees(void) {
-    // Convert yawChange to degrees.
-    int16_t degrees = yawChange * DEGREES_IN_CIRCLE / SLOTS_IN_CIRCLE
-                      / YAW_CHANGE_PER_SLOT;
+    // Reduce to within one circle before converting to whole degrees,
+    // rounding to the nearest degree.
+    int32_t centiDegrees = yawCentiDegrees() % CENTIDEGREES_IN_CIRCLE;
+    int16_t degrees;
+
+    if (centiDegrees >= 0) {
+        degrees = (centiDegrees + 50) / 100;
+    } else {
+        degrees = (centiDegrees - 50) / 100;
+    }
 
     return convertYawToRange(degrees);
 }
 
+//*****************************************************************************
+// Returns the current value of the free-running timer used to timestamp
+// yaw edges, which counts up at the system clock rate.
+//*****************************************************************************
+uint32_t yawTimestamp(void) {
+    return TimerValueGet(YAW_TIMER_BASE, YAW_TIMER);
+}
+
+//*****************************************************************************
+// Returns the raw quadrature count relative to the reference position.
+//*****************************************************************************
+int32_t yawCount(void) {
+    return yawChange;
+}
+
+//*****************************************************************************
+// Reads a consistent copy of the yaw count and the last edge's data,
+// retrying if an edge occurs part way through, and the time since the
+// last edge (in timer ticks).
+//*****************************************************************************
+static void yawReadEdge(int32_t* change, uint32_t* elapsed, int8_t* step,
+                        uint32_t* interval) {
+    uint32_t sequence;
+
+    do {
+        sequence = edgeSequence;
+        *change = yawChange;
+        *step = lastEdgeStep;
+        *interval = lastEdgeInterval;
+        *elapsed = TimerValueGet(YAW_TIMER_BASE, YAW_TIMER) - lastEdgeTime;
+    } while (sequence != edgeSequence);
+}
+
+//*****************************************************************************
+// Returns the yaw relative to the reference position in hundredths of a
+// degree. This value is not wrapped to the range -180 to 180 degrees.
+// Each yaw count is taken to be the middle of the range between the two
+// edges which lead to it, so a stationary helicopter is at its count,
+// whichever direction it arrived from. While rotating, the yaw is
+// interpolated from the edge using the interval between the last two edges,
+// up to the next edge. If that edge does not come, the yaw moves back to
+// the middle of the count by the time the helicopter is taken to be
+// stationary, so there is no jump when it is.
+//*****************************************************************************
+int32_t yawCentiDegrees(void) {
+    int32_t change;
+    uint32_t elapsed, interval;
+    int8_t step;
+    yawReadEdge(&change, &elapsed, &step, &interval);
+    uint32_t timeout = yawTimerRate / YAW_RATE_TIMEOUT_DIVISOR;
+
+    // Fraction of a yaw change moved since the last edge, in units of
+    // 1 / YAW_CHANGES_IN_CIRCLE of a yaw change. The edge is half a change
+    // behind the count, so half a change is the middle of the count.
+    int32_t fraction;
+    if (interval == 0 || interval >= timeout || elapsed >= timeout) {
+        fraction = YAW_CHANGES_IN_CIRCLE / 2;
+    } else if (elapsed < interval) {
+        fraction = (uint64_t) elapsed * YAW_CHANGES_IN_CIRCLE / interval;
+    } else {
+        fraction = YAW_CHANGES_IN_CIRCLE
+                   - (uint64_t) (elapsed - interval)
+                     * (YAW_CHANGES_IN_CIRCLE / 2) / (timeout - interval);
+    }
+
+    int64_t position = (int64_t) change * YAW_CHANGES_IN_CIRCLE
+                       + step * (fraction - YAW_CHANGES_IN_CIRCLE / 2);
+    return position * CENTIDEGREES_IN_CIRCLE
+           / (YAW_CHANGES_IN_CIRCLE * YAW_CHANGES_IN_CIRCLE);
+}
+
+//*****************************************************************************
+// Returns the yaw rate in hundredths of a degree per second, estimated from
+// the interval between the last two edges. If no edge has occurred for
+// longer than this interval the rotation must have slowed, so the time
+// since the last edge is used instead.
+//*****************************************************************************
+int32_t yawRateCentiDegrees(void) {
+    int32_t change;
+    uint32_t elapsed, interval;
+    int8_t step;
+    yawReadEdge(&change, &elapsed, &step, &interval);
+
+    if (interval == 0 || elapsed >= yawTimerRate / YAW_RATE_TIMEOUT_DIVISOR) {
+        return 0;
+    }
+
+    uint32_t period = (elapsed > interval) ? elapsed : interval;
+    return step * (int32_t) ((uint64_t) CENTIDEGREES_IN_CIRCLE * yawTimerRate
+                             / YAW_CHANGES_IN_CIRCLE / period);
+}
+
 //*****************************************************************************
 // Adds the given amount to the desired yaw, ensuring that the desired yaw
 // remains in the range of 180 to -180 degrees.
 //*****************************************************************************
 void yawChangeDesired(int16_t amount) {
-    desiredYaw = convertYawToRange(desiredYaw + amount);
+    int16_t desiredYaw = trajectoryTarget(&yawTrajectory);
+    trajectorySetTarget(&yawTrajectory, convertYawToRange(desiredYaw + amount));
 }
 
 //*****************************************************************************
-// Called when the helicopter is returning to the reference yaw for landing.
-// Moves the desired yaw towards zero by the given amount. If the yaw has
-// reached the reference, changes the state of the helicopter.
+// Advances the reference yaw towards the desired yaw. Should be called at the
+// given update rate (in Hz), before the yaw error is used.
 //*****************************************************************************
-void yawUpdateLanding(int16_t amount) {
-    if (desiredYaw < 0) {
-        desiredYaw += amount;
-        if (desiredYaw > 0) {
-            desiredYaw = 0;
-        }
-    } else if (desiredYaw > 0) {
-        desiredYaw -= amount;
-        if (desiredYaw < 0) {
-            desiredYaw = 0;
-        }
-    } else {    // desiredYaw == 0
-        if (yawError() == 0) {
-            setFlightState(LANDING_ALTITUDE);
-        }
+void yawUpdateReference(uint16_t updateRate) {
+    referenceUpdateRate = updateRate;
+    trajectoryUpdate(&yawTrajectory, updateRate);
+}
+
+//*****************************************************************************
+// Called at each control update while searching for the yaw reference.
+// Keeps the desired yaw a fixed distance ahead of the reference yaw, so that
+// the reference sweeps round continuously at the rate limit until the
+// reference is found.
+//*****************************************************************************
+void yawUpdateSearch(void) {
+    trajectorySetTarget(&yawTrajectory,
+                        convertYawToRange(trajectoryPosition(&yawTrajectory)
+                                          + YAW_SEARCH_LEAD));
+}
+
+//*****************************************************************************
+// Starts returning the helicopter to the reference yaw for landing, by
+// setting the desired yaw to zero.
+//*****************************************************************************
+void yawStartLanding(void) {
+    trajectorySetTarget(&yawTrajectory, 0);
+    landingDwellUpdates = 0;
+}
+
+//*****************************************************************************
+// Returns whether the reference has reached zero and the yaw has been
+// within the landing tolerance of it for the landing dwell time, after
+// yawStartLanding was called. Should be called at each control update.
+//*****************************************************************************
+bool yawLandingComplete(void) {
+    int16_t error = yawError();
+
+    if (!trajectoryFinished(&yawTrajectory)
+            || error > landingTolerance || error < -landingTolerance) {
+        landingDwellUpdates = 0;
+        return false;
     }
+
+    landingDwellUpdates++;
+    return landingDwellUpdates * 1000
+           >= (uint32_t) landingDwellMs * referenceUpdateRate;
+}
+
+//*****************************************************************************
+// Sets the band around zero which the yaw must stay within (in degrees),
+// and for how long (in ms), for the yaw part of a landing to be complete.
+//*****************************************************************************
+void yawSetLandingTolerance(uint16_t tolerance, uint16_t dwellMs) {
+    landingTolerance = tolerance;
+    landingDwellMs = dwellMs;
 }
 
 //*****************************************************************************
 // Returns the desired yaw in degrees.
 //*****************************************************************************
 int16_t yawDesired(void) {
-    return desiredYaw;
+    return trajectoryTarget(&yawTrajectory);
+}
+
+//*****************************************************************************
+// Returns the current reference yaw in degrees, which moves smoothly towards
+// the desired yaw.
+//*****************************************************************************
+int16_t yawReference(void) {
+    return trajectoryPosition(&yawTrajectory);
 }
 
 //*****************************************************************************
-// Calculates and returns the difference between the desired yaw and the
+// Calculates and returns the difference between the reference yaw and the
 // actual yaw in degrees, taking into account that both these values are in
 // the range -180 to 180 degrees. Therefore the returned error will also be
 // in this range.
 //*****************************************************************************
 int16_t yawError(void) {
-    return convertYawToRange(desiredYaw - yawDegrees());
+    return convertYawToRange(yawReference() - yawDegrees());
 }
@@ -20,12 +20,70 @@
 //*****************************************************************************
 void initYaw(void);
 
+//*****************************************************************************
+// Processes an edge on yaw channel A or B. Compares the current values of
+// the two input yaw channels to their previous values to determine the
+// direction of rotation and updates the yaw value as needed. Each edge is
+// timestamped, so that the yaw can be interpolated between edges and the
+// yaw rate estimated. Called from the yaw channel interrupt handler, or when
+// replaying captured edges.
+//*****************************************************************************
+void yawProcessChannels(bool currentChannelA, bool currentChannelB,
+                        uint32_t now);
+
+//*****************************************************************************
+// Processes the yaw reference signal. If the helicopter is currently taking
+// off, and therefore trying to find the yaw reference point, latches the
+// yaw count at this edge and notifies the flight state machine, which then
+// calls yawReconcileReference. Otherwise the signal is ignored. Called from
+// the yaw reference interrupt handler, or when replaying captured inputs.
+//*****************************************************************************
+void yawProcessReference(void);
+
+//*****************************************************************************
+// Returns the current value of the free-running timer used to timestamp
+// yaw edges, which counts up at the system clock rate.
+//*****************************************************************************
+uint32_t yawTimestamp(void);
+
+//*****************************************************************************
+// Takes an arbitrary yaw value in degrees, and converts it to an equivalent
+// value in the range of -180 to 180 degrees.
+//*****************************************************************************
+int16_t convertYawToRange(int16_t yaw);
+
 //*****************************************************************************
 // Calculate and return the yaw in degrees, relative to the reference position.
 // The yaw will be in the range -180 to 180 degrees.
 //*****************************************************************************
 int16_t yawDegrees(void);
 
+//*****************************************************************************
+// Returns the raw quadrature count relative to the reference position.
+//*****************************************************************************
+int32_t yawCount(void);
+
+//*****************************************************************************
+// Returns the yaw relative to the reference position in hundredths of a
+// degree. This value is not wrapped to the range -180 to 180 degrees.
+// Each yaw count is taken to be the middle of the range between the two
+// edges which lead to it, so a stationary helicopter is at its count,
+// whichever direction it arrived from. While rotating, the yaw is
+// interpolated from the edge using the interval between the last two edges,
+// up to the next edge. If that edge does not come, the yaw moves back to
+// the middle of the count by the time the helicopter is taken to be
+// stationary, so there is no jump when it is.
+//*****************************************************************************
+int32_t yawCentiDegrees(void);
+
+//*****************************************************************************
+// Returns the yaw rate in hundredths of a degree per second, estimated from
+// the interval between the last two edges. If no edge has occurred for
+// longer than this interval the rotation must have slowed, so the time
+// since the last edge is used instead.
+//*****************************************************************************
+int32_t yawRateCentiDegrees(void);
+
 //*****************************************************************************
 // Adds the given amount to the desired yaw, ensuring that the desired yaw
 // remains in the range of 180 to -180 degrees.
@@ -33,11 +91,47 @@ int16_t yawDegrees(void);
 void yawChangeDesired(int16_t amount);
 
 //*****************************************************************************
-// Called when the helicopter is returning to the reference yaw for landing.
-// Moves the desired yaw towards zero by the given amount. If the yaw has
-// reached the reference, changes the state of the helicopter.
+// Advances the reference yaw towards the desired yaw. Should be called at the
+// given update rate (in Hz), before the yaw error is used.
+//*****************************************************************************
+void yawUpdateReference(uint16_t updateRate);
+
+//*****************************************************************************
+// Called at each control update while searching for the yaw reference.
+// Keeps the desired yaw a fixed distance ahead of the reference yaw, so that
+// the reference sweeps round continuously at the rate limit until the
+// reference is found.
+//*****************************************************************************
+void yawUpdateSearch(void);
+
+//*****************************************************************************
+// Makes the reference position found by yawProcessReference the zero yaw.
+// The yaw count, the yaw estimate and the reference yaw are all moved by
+// the yaw at the reference edge, so the reference yaw keeps its velocity
+// and the yaw error is unchanged, then the desired yaw is set to zero.
+// The vehicle state is published again, so that the snapshot used by the
+// controller is in the new frame.
+//*****************************************************************************
+void yawReconcileReference(void);
+
+//*****************************************************************************
+// Starts returning the helicopter to the reference yaw for landing, by
+// setting the desired yaw to zero.
 //*****************************************************************************
-void yawUpdateLanding(int16_t amount);
+void yawStartLanding(void);
+
+//*****************************************************************************
+// Returns whether the reference has reached zero and the yaw has been
+// within the landing tolerance of it for the landing dwell time, after
+// yawStartLanding was called. Should be called at each control update.
+//*****************************************************************************
+bool yawLandingComplete(void);
+
+//*****************************************************************************
+// Sets the band around zero which the yaw must stay within (in degrees),
+// and for how long (in ms), for the yaw part of a landing to be complete.
+//*****************************************************************************
+void yawSetLandingTolerance(uint16_t tolerance, uint16_t dwellMs);
 
 //*****************************************************************************
 // Returns the desired yaw in degrees.
@@ -45,7 +139,13 @@ void yawUpdateLanding(int16_t amount);
 int16_t yawDesired(void);
 
 //*****************************************************************************
-// Calculates and returns the difference between the desired yaw and the
+// Returns the current reference yaw in degrees, which moves smoothly towards
+// the desired yaw.
+//*****************************************************************************
+int16_t yawReference(void);
+
+//*****************************************************************************
+// Calculates and returns the difference between the reference yaw and the
 // actual yaw in degrees, taking into account that both these values are in
 // the range -180 to 180 degrees. Therefore the returned error will also be
 // in this range.